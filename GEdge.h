@@ -14,45 +14,88 @@
 #include <limits>
 #include <vector>
 
+// 16.16 fixed point
+typedef int32_t GFixed;
+
+const int kFixedShift = 16;
+
+// Keeps converted values well inside the int32 range; no device coordinate gets near this.
+const double kFixedMaxValue = 30000.0;
+
+static inline GFixed double_to_fixed(double x) {
+    x = std::max(-kFixedMaxValue, std::min(x, kFixedMaxValue));
+    return (GFixed)floor(x * (1 << kFixedShift) + 0.5);
+}
+
+/**
+ *  Edges whose ends are within this distance of x = 0 keep their true x rather than being cut
+ *  at the sides of the device. Their x fits in 16.16, and so does x stepped once past the
+ *  end, as long as dx stays within kMaxEdgeDX.
+ */
+const float kUnclippedMaxX = (float)(kFixedMaxValue / 3);
+
+/**
+ *  The largest change in x per row an edge steps by. An edge that crosses two row centers
+ *  with both ends inside kUnclippedMaxX can't be this steep; one that crosses a single row
+ *  center can, but its x is read on that row only, so only the (unread) step past its end
+ *  is affected.
+ */
+const double kMaxEdgeDX = kFixedMaxValue - kUnclippedMaxX;
+
+// Same rounding as GRoundToInt: floor(x + 0.5)
+static inline int fixed_round_to_int(GFixed x) {
+    return (x + (1 << (kFixedShift - 1))) >> kFixedShift;
+}
+
+/**
+ *  A line segment covering rows [y0, y1), stepped one row at a time with integer adds.
+ *
+ *  x starts out as the segment's x at the center of row y0 (y0 + 0.5) and the scanners add
+ *  dx to it as they move down, so every compiler and optimization level produces the same
+ *  crossings. The setup is done in double so the rounding into fixed point is the only loss.
+ */
 struct Edge {
-    GPoint start;
-    GPoint end;
-    float m, b, x0;
+    GFixed x;       // x at the center of the current row
+    GFixed dx;      // change in x per row
     int y0, y1;
     int wind;
+    int curve = -1; // index of the CurveEdge this is the current segment of, or -1 for a line
 
-    Edge(const GPoint& p1, const GPoint& p2, const int wind) : start(p1), end(p2), wind(wind) {
-        if (start.y > end.y) {
-            std::swap(start, end);
-            this->wind = -this->wind;
+    Edge(GPoint p0, GPoint p1, const int wind) : wind(wind) {
+        if (p0.y > p1.y) {
+            std::swap(p0, p1);
         }
-        this->wind = wind;
-        calculateProperties();
-    }
 
-    void calculateProperties() {
-        m = (end.x - start.x) / (end.y - start.y);
-        b = start.x - m * start.y;
-        y0 = GRoundToInt(std::min(start.y, end.y));
-        y1 = GRoundToInt(std::max(start.y, end.y));
-        x0 = m * (y0 + 0.5f) + b;
-    }
+        y0 = GRoundToInt(p0.y);
+        y1 = GRoundToInt(p1.y);
+
+        if (y0 == y1) {
+            // covers no row centers, so it is never scanned
+            x = dx = 0;
+            return;
+        }
 
-    float computeX(int y) const {
-        return start.x + m * (y - start.y);
+        double m = ((double)p1.x - p0.x) / ((double)p1.y - p0.y);
+        x = double_to_fixed(p0.x + m * (y0 + 0.5 - p0.y));
+        dx = double_to_fixed(std::max(-kMaxEdgeDX, std::min(m, kMaxEdgeDX)));
     }
 };
 
-inline bool isValidEdge(Edge edge, int y) {
+inline bool isValidEdge(const Edge& edge, int y) {
     return edge.y0 <= y && edge.y1 > y;
 }
 
-inline std::vector<Edge> clipEdges(int bottom, int right, GPoint p0, GPoint p1) {
-    std::vector<Edge> edges;
+/**
+ *  Appends the edges that p0..p1 makes once clipped to the rows of the device. Edges keep
+ *  their true x past the sides of the device and the blitters clamp the spans to
+ *  [0, right). Only a line reaching past kUnclippedMaxX is cut at the sides, with the parts
+ *  beyond them projected onto the side as vertical edges.
+ */
+inline void clipEdges(int bottom, int right, GPoint p0, GPoint p1, std::vector<Edge>& edges) {
     int wind;
 
     if (p0.y == p1.y) {
-        return edges;
+        return;
     }
 
     if (p0.y > p1.y) {
@@ -63,7 +106,7 @@ inline std::vector<Edge> clipEdges(int bottom, int right, GPoint p0, GPoint p1)
     }
 
     if (p1.y <= 0 || p0.y >= bottom) {
-        return edges;
+        return;
     }
 
     float m = (p1.x - p0.x) / (p1.y - p0.y);
@@ -79,6 +122,16 @@ inline std::vector<Edge> clipEdges(int bottom, int right, GPoint p0, GPoint p1)
         p1.y = bottom;
     }
 
+    if (fabsf(p0.x) < kUnclippedMaxX && fabsf(p1.x) < kUnclippedMaxX) {
+        Edge edge = {p0, p1, wind};
+
+        if (edge.y0 < edge.y1) {
+            edges.push_back(edge);
+        }
+
+        return;
+    }
+
     if (p0.x > p1.x) {
         std::swap(p0, p1);
     }
@@ -92,7 +145,7 @@ inline std::vector<Edge> clipEdges(int bottom, int right, GPoint p0, GPoint p1)
             edges.push_back(edge);
         }
         
-        return edges;
+        return;
     }
 
     // right projection
@@ -103,7 +156,7 @@ inline std::vector<Edge> clipEdges(int bottom, int right, GPoint p0, GPoint p1)
             edges.push_back(edge);
         }
 
-        return edges;
+        return;
     }
 
     // left straddle
@@ -137,18 +190,16 @@ inline std::vector<Edge> clipEdges(int bottom, int right, GPoint p0, GPoint p1)
     if (isValidEdge(lastEdge, GRoundToInt(lastEdge.y0))) {
         edges.push_back(lastEdge);
     }
-
-    return edges;
 }
 
-inline int quadSegmentsNum(GPoint points[3]) {
+inline int quadSegmentsNum(const GPoint points[3]) {
     GPoint error = (points[0] - (2 * points[1]) + points[2]) * 0.25f; // multiply instead of divide
     float distance = sqrt((error.x * error.x) + (error.y * error.y));
 
     return (int) ceil(sqrt(distance * 4));
 }
 
-inline int cubicSegmentsNum(GPoint points[4]) {
+inline int cubicSegmentsNum(const GPoint points[4]) {
     GPoint error1 = points[0] - 2 * points[1] + points[2];
     GPoint error2 = points[1] - 2 * points[2] + points[3];
 
@@ -160,127 +211,571 @@ inline int cubicSegmentsNum(GPoint points[4]) {
     return (int) ceil(sqrt(distance * 3));
 }
 
-inline std::vector<Edge> buildEdges(GBitmap device, int count, const GPoint points[]) {
-    int deviceRight = device.width();
-    int deviceBottom = device.height();
-
-    std::vector<Edge> edges;
-
+inline void buildEdges(int width, int height, int count, const GPoint points[], std::vector<Edge>& edges) {
     for (int i = 0; i < count; i++) {
         GPoint pt0 = points[i];
         GPoint pt1 = points[(i + 1) % count];
 
-        std::vector<Edge> clipped = clipEdges(deviceBottom, deviceRight, pt0, pt1);
+        clipEdges(height, width, pt0, pt1, edges);
+    }
+}
+
+// How many points GPath::Edger returns for the verb.
+inline int verbPointCount(GPathVerb verb) {
+    switch (verb) {
+        case GPathVerb::kMove:  return 1;
+        case GPathVerb::kLine:  return 2;
+        case GPathVerb::kQuad:  return 3;
+        case GPathVerb::kCubic: return 4;
+    }
+    return 0;
+}
+
+/**
+ *  Break the quad into quadSegmentsNum lines. The curve is stepped by forward differencing,
+ *  so each sample costs two adds per coordinate instead of a de Casteljau evaluation.
+ */
+template <typename LineProc> void flattenQuad(const GPoint points[3], LineProc& line) {
+    const int segmentsNum = quadSegmentsNum(points);
+    GPoint point1 = points[0];
+
+    if (segmentsNum > 1) {
+        // P(t) = A t^2 + B t + C, sampled every h = 1 / segmentsNum
+        const float h = 1.0f / segmentsNum;
+        const GPoint A = points[0] - 2 * points[1] + points[2];
+        const GPoint B = 2 * (points[1] - points[0]);
+
+        GPoint d1 = (h * h) * A + h * B;
+        const GPoint d2 = (2 * h * h) * A;
+
+        for (int i = 1; i < segmentsNum; i++) {
+            const GPoint point2 = point1 + d1;
+            line(point1, point2);
+            point1 = point2;
+            d1 += d2;
+        }
+    }
 
-        if (clipped.size() > 0) {
-            edges.insert(edges.end(), clipped.begin(), clipped.end());
+    line(point1, points[2]);
+}
+
+// Break the cubic into cubicSegmentsNum lines, stepped by forward differencing as above.
+template <typename LineProc> void flattenCubic(const GPoint points[4], LineProc& line) {
+    const int segmentsNum = cubicSegmentsNum(points);
+    GPoint point1 = points[0];
+
+    if (segmentsNum > 1) {
+        // P(t) = A t^3 + B t^2 + C t + D, sampled every h = 1 / segmentsNum
+        const float h = 1.0f / segmentsNum;
+        const float h2 = h * h;
+        const float h3 = h2 * h;
+        const GPoint A = points[3] - points[0] + 3 * (points[1] - points[2]);
+        const GPoint B = 3 * (points[0] - 2 * points[1] + points[2]);
+        const GPoint C = 3 * (points[1] - points[0]);
+
+        GPoint d1 = h3 * A + h2 * B + h * C;
+        GPoint d2 = (6 * h3) * A + (2 * h2) * B;
+        const GPoint d3 = (6 * h3) * A;
+
+        for (int i = 1; i < segmentsNum; i++) {
+            const GPoint point2 = point1 + d1;
+            line(point1, point2);
+            point1 = point2;
+            d1 += d2;
+            d2 += d3;
         }
     }
 
-    return edges;
+    line(point1, points[3]);
 }
 
-inline std::vector<Edge> pathBuildEdges(std::shared_ptr<GPath> path, int width, int height) {
-    std::vector<Edge> edges;
+/**
+ *  Walk the path, mapped by ctm, calling line(p0, p1) for each line and curve(points, count)
+ *  for each quad (count 3) or cubic (count 4). Points are mapped as they are read, so the
+ *  path itself is never copied.
+ */
+template <typename LineProc, typename CurveProc>
+void walkPath(const GPath& path, const GMatrix& ctm, LineProc line, CurveProc curve) {
     GPoint points[GPath::kMaxNextPoints];
-    GPath::Edger iterator(*path);
-    GPoint currentPoint;
+    GPath::Edger iterator(path);
 
     while (auto verb = iterator.next(points)) {
-        int segmentsNum;
-        GPoint point1, point2;
-        float t;
-        std::vector<Edge> new_edges;
+        ctm.mapPoints(points, verbPointCount(verb.value()));
 
         switch (verb.value()) {
             case GPathVerb::kLine:
-                new_edges = clipEdges(height, width, points[0], points[1]);
-
-                if (new_edges.size() > 0) {
-                    edges.insert(edges.end(), new_edges.begin(), new_edges.end());
-                }
-                
-                currentPoint = points[0];
+                line(points[0], points[1]);
                 break;
 
             case GPathVerb::kMove:
-                // hmmmmm
-                currentPoint = points[0];
                 break;
 
             case GPathVerb::kQuad:
-                point1 = points[0];
-                segmentsNum = quadSegmentsNum(points);
+                curve(points, 3);
+                break;
 
-                for (int i = 1; i < segmentsNum; i++) {
-                    t = i * (1.0f / segmentsNum);
+            case GPathVerb::kCubic:
+                curve(points, 4);
+                break;
+        }
+    }
+}
 
-                    point2 = { getQuadPoint(points[0].x, points[1].x, points[2].x, t).ABC, 
-                               getQuadPoint(points[0].y, points[1].y, points[2].y, t).ABC };
+/**
+ *  Walk the path, mapped by ctm, as line segments, calling line(p0, p1) for each. Quads and
+ *  cubics are broken into quadSegmentsNum / cubicSegmentsNum lines (measured after mapping).
+ */
+template <typename LineProc> void flattenPath(const GPath& path, const GMatrix& ctm, LineProc line) {
+    walkPath(path, ctm, line, [&](const GPoint points[], int count) {
+        if (count == 3) {
+            flattenQuad(points, line);
+        } else {
+            flattenCubic(points, line);
+        }
+    });
+}
 
-                    new_edges = clipEdges(height, width, point1, point2);
+/**
+ *  A quad or cubic whose y never decreases, scanned as the lines flattenQuad / flattenCubic
+ *  would make without ever storing them. The scan keeps one Edge for the whole curve (see
+ *  Edge::curve) and calls nextSegment() when the scanline runs off the end of it, so only
+ *  the segment being crossed exists at any time.
+ */
+class CurveEdge {
+public:
+    /**
+     *  points[0 ... count) is the quad (3) or cubic (4) in device space. wind is the path's
+     *  direction along it. Sets edge to the first segment that covers a row in [0, bottom),
+     *  or returns false if there is none.
+     */
+    bool setCurve(const GPoint points[], int count, int wind, int bottom, Edge& edge) {
+        fSegmentsLeft = std::max(1, count == 3 ? quadSegmentsNum(points) : cubicSegmentsNum(points));
+        fPoint = points[0];
+        fEnd = points[count - 1];
+        fWind = wind;
+        fBottom = bottom;
+
+        const float h = 1.0f / fSegmentsLeft;
+        if (count == 3) {
+            const GPoint A = points[0] - 2 * points[1] + points[2];
+            const GPoint B = 2 * (points[1] - points[0]);
+            fD1 = (h * h) * A + h * B;
+            fD2 = (2 * h * h) * A;
+            fD3 = {0, 0};
+        } else {
+            const float h2 = h * h;
+            const float h3 = h2 * h;
+            const GPoint A = points[3] - points[0] + 3 * (points[1] - points[2]);
+            const GPoint B = 3 * (points[0] - 2 * points[1] + points[2]);
+            const GPoint C = 3 * (points[1] - points[0]);
+            fD1 = h3 * A + h2 * B + h * C;
+            fD2 = (6 * h3) * A + (2 * h2) * B;
+            fD3 = (6 * h3) * A;
+        }
 
-                    if (new_edges.size() > 0) {
-                        edges.insert(edges.end(), new_edges.begin(), new_edges.end());
-                    }
+        return this->nextSegment(edge);
+    }
 
-                    point1 = point2;
-                }
+    /**
+     *  Replace edge with the curve's next segment that covers a row, clipped to [0, bottom).
+     *  It starts on the row the last one ended on. Returns false once the curve is done.
+     */
+    bool nextSegment(Edge& edge) {
+        while (fSegmentsLeft > 0) {
+            const GPoint p0 = fPoint;
+            GPoint p1 = --fSegmentsLeft == 0 ? fEnd : fPoint + fD1;
+            // differencing error must not turn the curve back up or carry it past its end
+            p1.y = std::min(std::max(p1.y, p0.y), fEnd.y);
+
+            fPoint = p1;
+            fD1 += fD2;
+            fD2 += fD3;
+
+            const int y0 = GRoundToInt(p0.y);
+            if (y0 >= fBottom) {
+                break;
+            }
+            if (GRoundToInt(p1.y) <= std::max(y0, 0)) {
+                continue;
+            }
+
+            const int curve = edge.curve;
+            edge = Edge(p0, p1, fWind);
+            edge.curve = curve;
+
+            if (edge.y0 < 0) {
+                edge.x += (GFixed)((int64_t)-edge.y0 * edge.dx);
+                edge.y0 = 0;
+            }
+            edge.y1 = std::min(edge.y1, fBottom);
+            return true;
+        }
 
-                new_edges = clipEdges(height, width, point1, points[2]);
+        fSegmentsLeft = 0;
+        return false;
+    }
 
-                if (new_edges.size() > 0) {
-                        edges.insert(edges.end(), new_edges.begin(), new_edges.end());
-                }
+private:
+    GPoint  fPoint, fEnd;           // start of the next segment, end of the curve
+    GPoint  fD1, fD2, fD3;          // forward differences
+    int     fSegmentsLeft;
+    int     fWind;
+    int     fBottom;
+};
 
-                break;
+// Roots of a t^2 + b t + c strictly inside (0, 1), in increasing order. Returns how many.
+inline int unit_quadratic_roots(float a, float b, float c, float roots[2]) {
+    int count = 0;
+    auto add = [&](float t) {
+        if (t > 0 && t < 1 && (count == 0 || t != roots[0])) {
+            roots[count++] = t;
+        }
+    };
 
-            case GPathVerb::kCubic:
-                point1 = points[0];
-                segmentsNum = cubicSegmentsNum(points);
+    if (a == 0) {
+        if (b != 0) {
+            add(-c / b);
+        }
+        return count;
+    }
 
-                for (int i = 1; i < segmentsNum; i++) {
-                    t = i * (1.0f / segmentsNum);
+    const double discriminant = (double)b * b - 4.0 * a * c;
+    if (discriminant < 0) {
+        return 0;
+    }
 
-                    point2 = { getCubicPoint(points[0].x, points[1].x, points[2].x, points[3].x, t).ABCD, 
-                               getCubicPoint(points[0].y, points[1].y, points[2].y, points[3].y, t).ABCD };
+    // the numerically stable form: q = -(b + sign(b) sqrt(d)) / 2, roots q / a and c / q
+    const double q = -0.5 * (b + (b < 0 ? -sqrt(discriminant) : sqrt(discriminant)));
+    add((float)(q / a));
+    if (q != 0) {
+        add((float)(c / q));
+    }
+    if (count == 2 && roots[0] > roots[1]) {
+        std::swap(roots[0], roots[1]);
+    }
+    return count;
+}
 
-                    new_edges = clipEdges(height, width, point1, point2);
+/**
+ *  Split the quad (count 3) or cubic (count 4) where its y turns around, so that y only
+ *  goes one way along each piece. Pieces share end points: piece i is
+ *  dst[i * (count - 1) ... i * (count - 1) + count). Returns the number of pieces.
+ */
+inline int chopMonotonicY(const GPoint src[], int count, GPoint dst[10]) {
+    float roots[2];
+    int rootCount;
 
-                    if (new_edges.size() > 0) {
-                        edges.insert(edges.end(), new_edges.begin(), new_edges.end());
-                    }
+    if (count == 3) {
+        // y'(t) = 0 at t = (y0 - y1) / (y0 - 2 y1 + y2)
+        rootCount = unit_quadratic_roots(0, src[0].y - 2 * src[1].y + src[2].y, src[1].y - src[0].y, roots);
+    } else {
+        // y'(t) / 3 = a t^2 + b t + c
+        rootCount = unit_quadratic_roots(src[3].y - src[0].y + 3 * (src[1].y - src[2].y),
+                                         2 * (src[0].y - 2 * src[1].y + src[2].y),
+                                         src[1].y - src[0].y, roots);
+    }
 
-                    point1 = point2;
-                }
+    std::copy(src, src + count, dst);
+
+    float start = 0;
+    for (int i = 0; i < rootCount; ++i) {
+        GPoint* piece = dst + i * (count - 1);
+        const float t = (roots[i] - start) / (1 - start);
+        GPoint chopped[7];
+
+        if (count == 3) {
+            GPath::ChopQuadAt(piece, chopped, t);
+        } else {
+            GPath::ChopCubicAt(piece, chopped, t);
+        }
+        // the control points around a turning point are level with it
+        chopped[count - 2].y = chopped[count].y = chopped[count - 1].y;
+
+        std::copy(chopped, chopped + 2 * count - 1, piece);
+        start = roots[i];
+    }
+
+    return rootCount + 1;
+}
+
+/**
+ *  Handle a quad (count 3) or cubic (count 4) whose control points, and so the whole curve,
+ *  miss the device [0, width) x [0, height), without flattening it. Returns false if the
+ *  curve is (maybe) on the device and still needs its edges built.
+ */
+inline bool cullCurve(const GPoint points[], int count, int width, int height,
+                      std::vector<Edge>& edges) {
+    float left = points[0].x, top = points[0].y, right = left, bottom = top;
+    for (int i = 1; i < count; ++i) {
+        left = std::min(left, points[i].x);
+        top = std::min(top, points[i].y);
+        right = std::max(right, points[i].x);
+        bottom = std::max(bottom, points[i].y);
+    }
+
+    if (bottom <= 0 || top >= height) {
+        return true;
+    }
+
+    if (right <= 0 || left >= width) {
+        // clipEdges would project every piece onto the device's side, where the pieces'
+        // rows cancel out except for the ones between the curve's two ends
+        const float x = right <= 0 ? 0 : (float)width;
+        clipEdges(height, width, {x, points[0].y}, {x, points[count - 1].y}, edges);
+        return true;
+    }
+
+    return false;
+}
 
-                new_edges = clipEdges(height, width, point1, points[3]);
+// Curves reaching past kUnclippedMaxX (or far past the rows) are flattened and clipped instead.
+inline bool fitsCurveEdge(const GPoint points[], int count) {
+    for (int i = 0; i < count; ++i) {
+        if (!(fabsf(points[i].x) < kUnclippedMaxX && fabsf(points[i].y) < kFixedMaxValue)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ *  Append the edges of the path, mapped by ctm, clipped to the rows [0, height) of a device
+ *  width wide (see clipEdges). Quads and cubics that miss the device are culled (see cullCurve); the
+ *  rest are split into pieces monotonic in y first.
+ *
+ *  With curves, each piece becomes a CurveEdge in curves plus a single Edge (pointing at it
+ *  through Edge::curve) for the scan to step along. Only MyCanvas::pathScan knows how to scan
+ *  those. Without curves, every segment of the CurveEdge is added as a line edge instead, so
+ *  either way the same edges are scanned.
+ *
+ *  Only the serial scan passes curves. The banded and tiled scans, and the EdgeCache, take
+ *  every segment up front, so for them a curve-heavy path still costs a full edge list.
+ */
+inline void pathBuildEdges(const GPath& path, const GMatrix& ctm, int width, int height,
+                           std::vector<Edge>& edges, std::vector<CurveEdge>* curves = nullptr) {
+    auto line = [&](GPoint p0, GPoint p1) {
+        clipEdges(height, width, p0, p1, edges);
+    };
+
+    walkPath(path, ctm, line, [&](const GPoint points[], int count) {
+        if (cullCurve(points, count, width, height, edges)) {
+            return;
+        }
+
+        if (!fitsCurveEdge(points, count)) {
+            if (count == 3) {
+                flattenQuad(points, line);
+            } else {
+                flattenCubic(points, line);
+            }
+            return;
+        }
 
-                if (new_edges.size() > 0) {
-                        edges.insert(edges.end(), new_edges.begin(), new_edges.end());
+        GPoint pieces[10];
+        const int pieceCount = chopMonotonicY(points, count, pieces);
+
+        for (int i = 0; i < pieceCount; ++i) {
+            GPoint piece[4];
+            std::copy(pieces + i * (count - 1), pieces + i * (count - 1) + count, piece);
+
+            int wind = 1;
+            if (piece[0].y > piece[count - 1].y) {
+                std::reverse(piece, piece + count);
+                wind = -1;
+            } else if (piece[0].y == piece[count - 1].y) {
+                continue;
+            }
+
+            Edge edge({0, 0}, {0, 0}, wind);
+
+            if (!curves) {
+                // every segment up front, exactly as the scan would step through them
+                CurveEdge curve;
+                for (bool more = curve.setCurve(piece, count, wind, height, edge); more;
+                     more = curve.nextSegment(edge)) {
+                    edges.push_back(edge);
                 }
+                continue;
+            }
+
+            edge.curve = (int)curves->size();
+            curves->emplace_back();
+            if (curves->back().setCurve(piece, count, wind, height, edge)) {
+                edges.push_back(edge);
+            } else {
+                curves->pop_back();
+            }
+        }
+    });
+}
 
-                break;
+/**
+ *  The edges a scanline is crossing, kept as parallel arrays rather than Edges: row to row
+ *  the scan only reads x and wind and steps x by dx, and that step is one pass over two
+ *  contiguous arrays that the compiler can vectorize. edge (the index of the Edge each
+ *  entry came from) is only read when an entry runs out.
+ */
+struct ActiveEdges {
+    std::vector<GFixed> x, dx;
+    std::vector<int>    y1, wind;
+    std::vector<int>    edge;
+
+    int size() const { return (int)x.size(); }
+
+    void clear() { this->resize(0); }
+
+    void reserve(int count) {
+        x.reserve(count);
+        dx.reserve(count);
+        y1.reserve(count);
+        wind.reserve(count);
+        edge.reserve(count);
+    }
 
+    void resize(int count) {
+        x.resize(count);
+        dx.resize(count);
+        y1.resize(count);
+        wind.resize(count);
+        edge.resize(count);
+    }
+
+    // Put edges[index] at slot i, e.g. when a curve moves on to its next segment.
+    void set(int i, const Edge& e, int index) {
+        x[i] = e.x;
+        dx[i] = e.dx;
+        y1[i] = e.y1;
+        wind[i] = e.wind;
+        edge[i] = index;
+    }
+
+    // Copy slot from into slot to.
+    void move(int from, int to) {
+        x[to] = x[from];
+        dx[to] = dx[from];
+        y1[to] = y1[from];
+        wind[to] = wind[from];
+        edge[to] = edge[from];
+    }
+
+    // x only changes a little from row to row, so an insertion sort is about one pass.
+    void sortByX() {
+        const int count = this->size();
+        for (int i = 1; i < count; ++i) {
+            if (x[i - 1] <= x[i]) {
+                continue;
+            }
+
+            const GFixed xi = x[i], dxi = dx[i];
+            const int y1i = y1[i], windi = wind[i], edgei = edge[i];
+            int j = i;
+            while (j > 0 && x[j - 1] > xi) {
+                this->move(j - 1, j);
+                j--;
+            }
+            x[j] = xi;
+            dx[j] = dxi;
+            y1[j] = y1i;
+            wind[j] = windi;
+            edge[j] = edgei;
         }
     }
 
-    return edges;
+    /**
+     *  Add edges[first ... last), which start on this row and are sorted by x, to the
+     *  (sorted) active edges. Merging from the back moves each entry at most once, where
+     *  appending and insertion sorting would move the list once per new edge.
+     */
+    void merge(const std::vector<Edge>& edges, int first, int last) {
+        int i = this->size() - 1;
+        int out = i + (last - first);
+        this->resize(out + 1);
+
+        for (int j = last - 1; j >= first; --j, --out) {
+            while (i >= 0 && x[i] > edges[j].x) {
+                this->move(i--, out--);
+            }
+            this->set(out, edges[j], j);
+        }
+    }
 
+    // Move every edge down a row.
+    void step() {
+        GFixed* xs = x.data();
+        const GFixed* dxs = dx.data();
+        const int count = this->size();
+        for (int i = 0; i < count; ++i) {
+            xs[i] += dxs[i];
+        }
+    }
+};
+
+inline bool sortEdgesByX(const Edge& e0, const Edge& e1) {
+    return e0.x < e1.x;
 }
 
-inline bool sortEdgesByX(Edge e0, Edge e1) {
-    return e0.x0 < e1.x0;
+/**
+ *  Put the edges in the order sortEdges gives (y0, then x) through a scanline table: each
+ *  edge is counted into its y0 row's bucket, the buckets are laid out one after another, and
+ *  only the edges sharing a row are sorted by x. That is O(edges + rows) rather than a
+ *  comparison sort of all the edges. rowStarts and copy are working memory.
+ */
+inline void sortEdgesByRow(std::vector<Edge>& edges, std::vector<int>& rowStarts,
+                           std::vector<Edge>& copy) {
+    if (edges.size() < 2) {
+        return;
+    }
+
+    int top = edges[0].y0, bottom = edges[0].y0;
+    for (const Edge& edge : edges) {
+        top = std::min(top, edge.y0);
+        bottom = std::max(bottom, edge.y0);
+    }
+
+    // count each row, then turn the counts into where each row's edges start
+    const int rows = bottom - top + 1;
+    rowStarts.assign(rows + 1, 0);
+    for (const Edge& edge : edges) {
+        rowStarts[edge.y0 - top + 1] += 1;
+    }
+    for (int row = 1; row <= rows; ++row) {
+        rowStarts[row] += rowStarts[row - 1];
+    }
+
+    // rowStarts[row] advances past each edge placed, ending where the next row starts
+    copy.assign(edges.begin(), edges.end());
+    for (const Edge& edge : copy) {
+        edges[rowStarts[edge.y0 - top]++] = edge;
+    }
+
+    int start = 0;
+    for (int row = 0; row < rows; ++row) {
+        const int end = rowStarts[row];
+        if (end - start > 16) {
+            std::sort(edges.begin() + start, edges.begin() + end, sortEdgesByX);
+        } else {
+            for (int i = start + 1; i < end; ++i) {
+                const Edge edge = edges[i];
+                int j = i;
+                while (j > start && edges[j - 1].x > edge.x) {
+                    edges[j] = edges[j - 1];
+                    j--;
+                }
+                edges[j] = edge;
+            }
+        }
+        start = end;
+    }
 }
 
-inline bool sortEdges(Edge e0, Edge e1) {
+inline bool sortEdges(const Edge& e0, const Edge& e1) {
     if (e0.y0 < e1.y0) {
         return true;
     } else if (e1.y0 < e0.y0) {
         return false; 
     }
 
-    return e0.x0 < e1.x0;
+    return e0.x < e1.x;
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,217 @@
+/*
+ *  Copyright 2024 Tyler Roth
+ */
+
+#ifndef _g_accumulator_h_
+#define _g_accumulator_h_
+
+#include "include/GPoint.h"
+#include "include/GRect.h"
+#include "blitter.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+/**
+ *  Turn one row of accumulated area into coverage: running sum, then |sum| clamped to 1 and
+ *  scaled to 0...255. The row is zeroed as it is read, along with the two slots past its end.
+ */
+static inline void accumulate_row(float acc[], uint8_t coverage[], int count) {
+    float total = 0;
+    int i = 0;
+
+#if defined(__SSE2__)
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    __m128 carry = _mm_setzero_ps();
+
+    for (; i + 4 <= count; i += 4) {
+        // prefix sum of four lanes in two shifted adds, plus everything to the left
+        __m128 x = _mm_loadu_ps(acc + i);
+        x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4)));
+        x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 8)));
+        x = _mm_add_ps(x, carry);
+        carry = _mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 3, 3));
+
+        __m128 cov = _mm_min_ps(_mm_andnot_ps(signBit, x), one);
+        __m128i c = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(cov, scale), half));
+        c = _mm_packs_epi32(c, c);
+        c = _mm_packus_epi16(c, c);
+
+        int32_t bytes = _mm_cvtsi128_si32(c);
+        memcpy(coverage + i, &bytes, sizeof(bytes));
+        _mm_storeu_ps(acc + i, _mm_setzero_ps());
+    }
+    total = _mm_cvtss_f32(carry);
+#endif
+
+    for (; i < count; ++i) {
+        total += acc[i];
+        coverage[i] = (uint8_t)(std::min(fabsf(total), 1.0f) * 255.0f + 0.5f);
+        acc[i] = 0;
+    }
+    acc[count] = acc[count + 1] = 0;
+}
+
+/**
+ *  Exact-area anti-aliasing in the style of font-rs: every line deposits, in the pixels it
+ *  passes through, how much of each pixel lies to its right (signed by its direction). A
+ *  running sum along the row then gives the winding-weighted coverage of every pixel, and
+ *  nonzero fill keeps |coverage| clamped to 1.
+ *
+ *  The buffer holds the whole area at once, so this is meant for small (glyph or icon sized)
+ *  paths; see kMaxArea.
+ */
+class CoverageAccumulator {
+public:
+    // Past this many pixels the supersampler, which only keeps one row, is the better choice.
+    static constexpr int kMaxArea = 256 * 256;
+
+    // Floats needed for an area of this size.
+    static int StorageSize(const GIRect& area) { return (area.width() + 2) * area.height(); }
+
+    /**
+     *  area is in device pixels and must be inside the device. storage must hold
+     *  StorageSize(area) floats, all zero; blit() leaves them zeroed again.
+     */
+    CoverageAccumulator(const GIRect& area, float storage[])
+        : fArea(area), fStride(area.width() + 2), fAcc(storage) {}
+
+    // Add a line, in device coordinates. Only its part inside the area counts.
+    void addLine(GPoint p0, GPoint p1) {
+        p0 = {p0.x - fArea.left, p0.y - fArea.top};
+        p1 = {p1.x - fArea.left, p1.y - fArea.top};
+
+        float dir = 1;
+        if (p0.y > p1.y) {
+            std::swap(p0, p1);
+            dir = -1;
+        }
+
+        const float height = (float)fArea.height();
+        if (p0.y == p1.y || p1.y <= 0 || p0.y >= height) {
+            return;
+        }
+
+        const float dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+        if (p0.y < 0) {
+            p0 = {p0.x - p0.y * dxdy, 0};
+        }
+        if (p1.y > height) {
+            p1 = {p1.x - (p1.y - height) * dxdy, height};
+        }
+
+        this->addClippedX(p0, p1, dir);
+    }
+
+    /**
+     *  Resolve each row into coverage and hand it to the blitter's blitAntiRow(). coverage
+     *  needs a row's room.
+     */
+    template <typename AntiBlitter> void blit(AntiBlitter& blitter, uint8_t coverage[]) {
+        const int width = fArea.width();
+
+        for (int y = 0; y < fArea.height(); ++y) {
+            accumulate_row(fAcc + y * fStride, coverage, width);
+            blitter.blitAntiRow(fArea.top + y, fArea.left, width, coverage);
+        }
+        memset(coverage, 0, width);
+    }
+
+private:
+    GIRect  fArea;
+    int     fStride;
+    float*  fAcc;
+
+    /**
+     *  p0 is above p1 and both are inside the rows of the area. Pieces left of the area are
+     *  pushed onto its left side (they still cover everything to their right) and pieces
+     *  right of it are dropped.
+     */
+    void addClippedX(GPoint p0, GPoint p1, float dir) {
+        const float width = (float)fArea.width();
+
+        for (float side : {0.0f, width}) {
+            if ((p0.x < side) != (p1.x < side) && p0.x != side && p1.x != side) {
+                const float y = p0.y + (side - p0.x) * (p1.y - p0.y) / (p1.x - p0.x);
+                const GPoint mid = {side, std::min(std::max(y, p0.y), p1.y)};
+                this->addClippedX(p0, mid, dir);
+                this->addClippedX(mid, p1, dir);
+                return;
+            }
+        }
+
+        if (p0.x >= width && p1.x >= width) {
+            return;
+        }
+        if (p0.x <= 0 && p1.x <= 0) {
+            p0.x = p1.x = 0;
+        }
+        this->accumulateLine(p0, p1, dir);
+    }
+
+    // The font-rs line routine; p0 is above p1 and the line is inside the area.
+    void accumulateLine(GPoint p0, GPoint p1, float dir) {
+        if (p0.y == p1.y) {
+            return;
+        }
+
+        const float width = (float)fArea.width();
+        const float dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+        float x = p0.x;
+
+        const int yEnd = std::min(fArea.height(), (int)ceilf(p1.y));
+        for (int y = (int)p0.y; y < yEnd; ++y) {
+            float* row = fAcc + y * fStride;
+
+            const float dy = std::min((float)(y + 1), p1.y) - std::max((float)y, p0.y);
+            // pinned so float error can't step outside the row
+            const float xNext = std::min(std::max(x + dxdy * dy, 0.0f), width);
+            const float d = dy * dir;
+
+            const float x0 = std::min(x, xNext);
+            const float x1 = std::max(x, xNext);
+            const float x0Floor = floorf(x0);
+            const int x0i = (int)x0Floor;
+            const float x1Ceil = ceilf(x1);
+            const int x1i = (int)x1Ceil;
+
+            if (x1i <= x0i + 1) {
+                // inside one pixel: split the cover by the line's average x
+                const float xmf = 0.5f * (x + xNext) - x0Floor;
+                row[x0i] += d - d * xmf;
+                row[x0i + 1] += d * xmf;
+            } else {
+                // crossing several pixels: the area under the line grows linearly across them
+                const float s = 1.0f / (x1 - x0);
+                const float x0f = x0 - x0Floor;
+                const float a0 = 0.5f * s * (1.0f - x0f) * (1.0f - x0f);
+                const float x1f = x1 - x1Ceil + 1.0f;
+                const float am = 0.5f * s * x1f * x1f;
+
+                row[x0i] += d * a0;
+                if (x1i == x0i + 2) {
+                    row[x0i + 1] += d * (1.0f - a0 - am);
+                } else {
+                    const float a1 = s * (1.5f - x0f);
+                    row[x0i + 1] += d * (a1 - a0);
+                    for (int xi = x0i + 2; xi < x1i - 1; ++xi) {
+                        row[xi] += d * s;
+                    }
+                    const float a2 = a1 + (x1i - x0i - 3) * s;
+                    row[x1i - 1] += d * (1.0f - a2 - am);
+                }
+                row[x1i] += d * am;
+            }
+
+            x = xNext;
+        }
+    }
+};
+
+#endif
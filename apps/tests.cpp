@@ -0,0 +1,364 @@
+/*
+ *  Copyright 2024 Tyler Roth
+ */
+
+// Checks for MyCanvas's optional modes. Prints each failure and returns non-zero if any.
+
+// The canvas's headers define the shader factories, so the canvas is compiled into this file
+// (see the tests target in the Makefile) rather than linked with its own copy of them.
+#include "../starter_canvas.cpp"
+#include "../debug_alloc.h"
+#include "../include/GPathBuilder.h"
+#include <functional>
+#include <iterator>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static int gFailures = 0;
+
+static void check(bool ok, const char* what, const char* mode) {
+    if (!ok) {
+        printf("FAIL: %s (%s)\n", what, mode);
+        gFailures += 1;
+    }
+}
+
+// Everything a scene draws, made up front so that drawing it doesn't allocate by itself.
+struct Assets {
+    GBitmap                 texture;
+    std::shared_ptr<GShader> bitmapShader;
+    std::shared_ptr<GShader> gradient;
+    std::shared_ptr<GPath>  star, blob, box, ring;
+
+    Assets() {
+        texture.alloc(16, 16);
+        for (int y = 0; y < 16; ++y) {
+            for (int x = 0; x < 16; ++x) {
+                *texture.getAddr(x, y) = GPixel_PackARGB(255, x * 16, y * 16, (x ^ y) * 16);
+            }
+        }
+        bitmapShader = GCreateBitmapShader(texture, GMatrix::Scale(3, 3), GTileMode::kRepeat);
+        const GColor colors[] = {{1, 0, 0, 1}, {0, 1, 0, 0.5f}, {0, 0, 1, 1}};
+        gradient = GCreateLinearGradient({0, 0}, {200, 150}, colors, 3, GTileMode::kMirror);
+
+        GPathBuilder builder;
+        GPoint points[5];
+        for (int i = 0; i < 5; ++i) {
+            const float angle = i * 4 * 3.14159f / 5;
+            points[i] = {100 + 90 * cosf(angle), 110 + 90 * sinf(angle)};
+        }
+        builder.addPolygon(points, 5);
+        builder.addCircle({100, 110}, 25, GPathDirection::kCW);
+        star = builder.detach();
+
+        builder.moveTo({20, 180});
+        builder.cubicTo({60, -40}, {260, 300}, {230, 40});
+        builder.quadTo({120, 250}, {20, 180});
+        blob = builder.detach();
+
+        builder.addRect(GRect::LTRB(140, 20, 240, 90));
+        box = builder.detach();
+
+        builder.addCircle({120, 130}, 110, GPathDirection::kCW);
+        builder.addCircle({140, 120}, 45, GPathDirection::kCCW);
+        ring = builder.detach();
+    }
+};
+
+// Draws every kind of geometry the canvas fills, aliased and anti-aliased, with colors and
+// shaders, a few of them under a rotation.
+static void draw_scene(MyCanvas& canvas, const Assets& assets) {
+    for (int i = 0; i < 2; ++i) {
+        const bool antiAlias = i == 1;
+
+        GPaint color(GColor::RGBA(0.2f, 0.6f, 0.9f, 0.7f));
+        color.setAntiAlias(antiAlias);
+        canvas.drawPath(*assets.star, color);
+        canvas.drawRect(GRect::LTRB(10.5f, 12.25f, 80, 60), color);
+
+        GPaint bitmap(assets.bitmapShader);
+        bitmap.setAntiAlias(antiAlias);
+        canvas.drawPath(*assets.blob, bitmap);
+        const GPoint quad[] = {{150, 100}, {250, 130}, {230, 240}, {120, 200}};
+        canvas.drawConvexPolygon(quad, 4, bitmap);
+
+        GPaint gradient(assets.gradient);
+        gradient.setAntiAlias(antiAlias);
+        canvas.save();
+        canvas.translate(128, 128);
+        canvas.rotate(0.3f + i);
+        canvas.translate(-128, -128);
+        canvas.drawPath(*assets.box, gradient);
+        canvas.drawRect(GRect::LTRB(30, 150, 110, 230), gradient);
+        canvas.restore();
+    }
+}
+
+struct Mode {
+    const char*                     name;
+    std::function<void(MyCanvas&)>  setUp;
+};
+
+// Each of these draws exactly the pixels the serial scan does.
+static const Mode gModes[] = {
+    {"serial",          [](MyCanvas&) {}},
+    {"tiled",           [](MyCanvas& canvas) { canvas.setTiledPaths(4); }},
+    {"bands",           [](MyCanvas& canvas) { canvas.setParallelBands(3); }},
+    {"edge cache",      [](MyCanvas& canvas) { canvas.setEdgeCache(1 << 20); }},
+    {"deferred clear",  [](MyCanvas& canvas) { canvas.setDeferredClear(true); }},
+};
+
+struct Clip {
+    const char* name;
+    // narrows canvas's clip, leaving its matrix as it was
+    void      (*apply)(MyCanvas& canvas, const Assets& assets);
+    // the same region, recorded as a mask
+    void      (*record)(MyCanvas& canvas, const Assets& assets, SpanList& region);
+};
+
+static const GRect kClipRect = GRect::LTRB(40.3f, 30.6f, 200.2f, 220.9f);
+
+// A rect under kSkew is no longer a rect, so it clips as a region. kUnskew undoes it
+// exactly, so what is drawn after it isn't moved by rounding.
+static const GMatrix kSkew(1, 0.5f, -60, 0, 1, 0);
+static const GMatrix kUnskew(1, -0.5f, 60, 0, 1, 0);
+
+static void record_rect(MyCanvas& canvas, const GRect& rect, SpanList& region) {
+    GPathBuilder builder;
+    builder.addRect(rect);
+    canvas.recordPath(*builder.detach(), false, region);
+}
+
+static const Clip gClips[] = {
+    {"clip rect",
+        [](MyCanvas& canvas, const Assets&) { canvas.clipRect(kClipRect); },
+        [](MyCanvas& canvas, const Assets&, SpanList& region) {
+            record_rect(canvas, kClipRect, region);
+        }},
+    {"skewed clip rect",
+        [](MyCanvas& canvas, const Assets&) {
+            canvas.concat(kSkew);
+            canvas.clipRect(kClipRect);
+            canvas.concat(kUnskew);
+        },
+        [](MyCanvas& canvas, const Assets&, SpanList& region) {
+            canvas.concat(kSkew);
+            record_rect(canvas, kClipRect, region);
+            canvas.concat(kUnskew);
+        }},
+    {"clip path",
+        [](MyCanvas& canvas, const Assets& assets) { canvas.clipPath(*assets.ring, false); },
+        [](MyCanvas& canvas, const Assets& assets, SpanList& region) {
+            canvas.recordPath(*assets.ring, false, region);
+        }},
+    {"anti-aliased clip path",
+        [](MyCanvas& canvas, const Assets& assets) { canvas.clipPath(*assets.ring, true); },
+        [](MyCanvas& canvas, const Assets& assets, SpanList& region) {
+            canvas.recordPath(*assets.ring, true, region);
+        }},
+    {"clip rect then path",
+        [](MyCanvas& canvas, const Assets& assets) {
+            canvas.clipRect(kClipRect);
+            canvas.clipPath(*assets.ring, false);
+        },
+        [](MyCanvas& canvas, const Assets& assets, SpanList& region) {
+            SpanList rect, ring;
+            record_rect(canvas, kClipRect, rect);
+            canvas.recordPath(*assets.ring, false, ring);
+            region.intersect(rect, ring);
+        }},
+};
+
+static const int kSize = 256;
+static const GColor kBackground = {1, 1, 1, 1};
+
+// Clear the device, let setUp change the canvas, then draw the scene.
+static void render(GBitmap& device, const Assets& assets,
+                   const std::function<void(MyCanvas&)>& setUp) {
+    device.alloc(kSize, kSize);
+    MyCanvas canvas(device);
+    canvas.clear(kBackground);
+    setUp(canvas);
+    draw_scene(canvas, assets);
+    canvas.flush();
+}
+
+static int count_differences(const GBitmap& a, const GBitmap& b) {
+    int count = 0;
+    for (int y = 0; y < a.height(); ++y) {
+        for (int x = 0; x < a.width(); ++x) {
+            count += *a.getAddr(x, y) != *b.getAddr(x, y);
+        }
+    }
+    return count;
+}
+
+static void test_modes_match_serial(const Assets& assets) {
+    GBitmap serial;
+    render(serial, assets, gModes[0].setUp);
+
+    for (const Mode& mode : gModes) {
+        GBitmap device;
+        render(device, assets, mode.setUp);
+        check(count_differences(device, serial) == 0, "same pixels as the serial scan", mode.name);
+    }
+}
+
+/**
+ *  Where the clip fully covers a pixel, it must be drawn as if there were no clip; where
+ *  the clip misses it, it must keep the background. After restore() the clip is gone.
+ */
+static void test_clips(const Assets& assets) {
+    GBitmap unclipped, background;
+    render(unclipped, assets, gModes[0].setUp);
+    background.alloc(kSize, kSize);
+    MyCanvas(background).clear(kBackground);
+
+    for (const Clip& clip : gClips) {
+        GBitmap scratch;
+        scratch.alloc(kSize, kSize);
+        MyCanvas recorder(scratch);
+        SpanList region;
+        clip.record(recorder, assets, region);
+        std::vector<uint8_t> coverage(kSize * kSize, 0);
+        for (const SpanList::Span& span : region.spans()) {
+            memset(&coverage[span.y * kSize + span.x0], span.coverage, span.x1 - span.x0);
+        }
+
+        for (const Mode& mode : gModes) {
+            GBitmap device;
+            render(device, assets, [&](MyCanvas& canvas) {
+                mode.setUp(canvas);
+                clip.apply(canvas, assets);
+            });
+
+            int inside = 0, outside = 0;
+            for (int y = 0; y < kSize; ++y) {
+                for (int x = 0; x < kSize; ++x) {
+                    const GPixel pixel = *device.getAddr(x, y);
+                    if (coverage[y * kSize + x] == 0xFF) {
+                        inside += pixel != *unclipped.getAddr(x, y);
+                    } else if (coverage[y * kSize + x] == 0) {
+                        outside += pixel != *background.getAddr(x, y);
+                    }
+                }
+            }
+            char name[128];
+            snprintf(name, sizeof(name), "%s, %s", clip.name, mode.name);
+            check(inside == 0, "pixels inside the clip are drawn as without it", name);
+            check(outside == 0, "pixels outside the clip are left alone", name);
+        }
+
+        // an opaque fill through the clip shows its coverage, partial coverage included
+        GBitmap fill;
+        fill.alloc(kSize, kSize);
+        MyCanvas fillCanvas(fill);
+        fillCanvas.clear(kBackground);
+        clip.apply(fillCanvas, assets);
+        fillCanvas.drawRect(GRect::WH(kSize, kSize), GPaint(GColor::RGBA(0, 0, 0, 1)));
+        int wrongCoverage = 0;
+        for (int y = 0; y < kSize; ++y) {
+            for (int x = 0; x < kSize; ++x) {
+                const int expected = 255 - coverage[y * kSize + x];
+                wrongCoverage += abs(GPixel_GetR(*fill.getAddr(x, y)) - expected) > 1;
+            }
+        }
+        check(wrongCoverage == 0, "a fill is scaled by the clip's coverage", clip.name);
+
+        GBitmap device;
+        render(device, assets, [&](MyCanvas& canvas) {
+            canvas.save();
+            clip.apply(canvas, assets);
+            canvas.restore();
+        });
+        check(count_differences(device, unclipped) == 0, "restore() removes the clip", clip.name);
+    }
+}
+
+// recordPath() / recordConvexPolygon() and then drawMask() draw what the direct calls do.
+static void test_masks(const Assets& assets) {
+    GBitmap direct, masked;
+    direct.alloc(kSize, kSize);
+    masked.alloc(kSize, kSize);
+    MyCanvas directCanvas(direct), maskedCanvas(masked);
+    directCanvas.clear(kBackground);
+    maskedCanvas.clear(kBackground);
+
+    SpanList mask;
+    const GPoint quad[] = {{150, 100}, {250, 130}, {230, 240}, {120, 200}};
+    for (int i = 0; i < 4; ++i) {
+        const bool antiAlias = i & 1;
+        GPaint paint = i < 2 ? GPaint(GColor::RGBA(0.9f, 0.3f, 0.1f, 0.6f)) : GPaint(assets.bitmapShader);
+        paint.setAntiAlias(antiAlias);
+        for (MyCanvas* canvas : {&directCanvas, &maskedCanvas}) {
+            canvas->save();
+            canvas->rotate(0.1f * i);
+        }
+
+        for (const std::shared_ptr<GPath>& path : {assets.star, assets.blob, assets.ring}) {
+            directCanvas.drawPath(*path, paint);
+            maskedCanvas.recordPath(*path, antiAlias, mask);
+            maskedCanvas.drawMask(mask, paint);
+        }
+        directCanvas.drawConvexPolygon(quad, 4, paint);
+        maskedCanvas.recordConvexPolygon(quad, 4, antiAlias, mask);
+        maskedCanvas.drawMask(mask, paint);
+
+        directCanvas.restore();
+        maskedCanvas.restore();
+    }
+    check(count_differences(direct, masked) == 0, "masks draw what the direct calls do", "serial");
+}
+
+// Once a scene has been drawn, drawing it again must not go to the heap (debug builds only).
+static void test_steady_state_allocations(const Assets& assets) {
+#ifdef NDEBUG
+    printf("skipping allocation checks: debugAllocationCount() only counts in debug builds\n");
+#else
+    std::vector<Mode> modes(std::begin(gModes), std::end(gModes));
+    for (const Clip& clip : gClips) {
+        modes.push_back({clip.name, [&](MyCanvas& canvas) { clip.apply(canvas, assets); }});
+    }
+
+    for (const Mode& mode : modes) {
+        GBitmap device;
+        device.alloc(kSize, kSize);
+        MyCanvas canvas(device);
+        mode.setUp(canvas);
+
+        for (int i = 0; i < 2; ++i) {
+            canvas.clear(kBackground);
+            draw_scene(canvas, assets);
+        }
+        canvas.flush();
+
+        const int64_t before = debugAllocationCount();
+        for (int i = 0; i < 3; ++i) {
+            canvas.clear(kBackground);
+            draw_scene(canvas, assets);
+        }
+        canvas.flush();
+        const int64_t allocations = debugAllocationCount() - before;
+        if (allocations != 0) {
+            printf("%lld allocations redrawing the scene\n", (long long)allocations);
+        }
+        check(allocations == 0, "steady-state draws don't allocate", mode.name);
+    }
+#endif
+}
+
+int main(int argc, const char* argv[]) {
+    Assets assets;
+    test_modes_match_serial(assets);
+    test_clips(assets);
+    test_masks(assets);
+    test_steady_state_allocations(assets);
+
+    if (gFailures) {
+        printf("%d failed\n", gFailures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
@@ -0,0 +1,125 @@
+/*
+ *  Copyright 2024 Tyler Roth
+ */
+
+#include "blend_span.h"
+#include "my_utils.h"
+#include <string.h>
+
+#if defined(__SSE2__)
+    #define G_BLEND_X86
+    #include <emmintrin.h>
+#endif
+
+#ifndef G_BLEND_X86
+namespace portable {
+    // One pixel at a time, using the same packed math as my_blend.h.
+    struct Ops {
+        typedef GPixel V;
+        static constexpr int N = 1;
+
+        static V load(const GPixel* p) { return *p; }
+        static void store(GPixel* p, V v) { *p = v; }
+        static V splat(GPixel p) { return p; }
+        static V zero() { return 0; }
+        static V alpha(V v) { return (v >> GPIXEL_SHIFT_A) * 0x01010101; }
+        static V inv(V v) { return ~v; }
+        static V mul(V x, V a) { return quad_mul_div255(x, a & 0xFF); }
+        static V add(V x, V y) { return x + y; }
+        static V coverage(const uint8_t* c) { return *c * 0x01010101; }
+    };
+
+    #include "blend_span_impl.h"
+}
+#else
+namespace sse2 {
+    // Four pixels at a time; channels are widened to 16 bits for the multiplies.
+    struct Ops {
+        typedef __m128i V;
+        static constexpr int N = 4;
+
+        static V load(const GPixel* p) { return _mm_loadu_si128((const __m128i*)p); }
+        static void store(GPixel* p, V v) { _mm_storeu_si128((__m128i*)p, v); }
+        static V splat(GPixel p) { return _mm_set1_epi32((int)p); }
+        static V zero() { return _mm_setzero_si128(); }
+
+        static V alpha(V v) {
+            V a = _mm_srli_epi32(v, GPIXEL_SHIFT_A);
+            a = _mm_or_si128(a, _mm_slli_epi32(a, 8));
+            return _mm_or_si128(a, _mm_slli_epi32(a, 16));
+        }
+
+        static V inv(V v) { return _mm_xor_si128(v, _mm_set1_epi32(-1)); }
+
+        // (x*a + 128 + ((x*a + 128) >> 8)) >> 8, which is exactly what quad_mul_div255 computes
+        static V mul16(V x, V a) {
+            V prod = _mm_add_epi16(_mm_mullo_epi16(x, a), _mm_set1_epi16(128));
+            return _mm_srli_epi16(_mm_add_epi16(prod, _mm_srli_epi16(prod, 8)), 8);
+        }
+
+        static V mul(V x, V a) {
+            const V z = _mm_setzero_si128();
+            V lo = mul16(_mm_unpacklo_epi8(x, z), _mm_unpacklo_epi8(a, z));
+            V hi = mul16(_mm_unpackhi_epi8(x, z), _mm_unpackhi_epi8(a, z));
+            return _mm_packus_epi16(lo, hi);
+        }
+
+        static V add(V x, V y) { return _mm_add_epi32(x, y); }
+
+        static V coverage(const uint8_t* c) {
+            int32_t bytes;
+            memcpy(&bytes, c, sizeof(bytes));
+            V v = _mm_cvtsi32_si128(bytes);
+            v = _mm_unpacklo_epi8(v, v);
+            return _mm_unpacklo_epi16(v, v);
+        }
+    };
+
+    #include "blend_span_impl.h"
+}
+
+// Defined in blend_span_avx2.cpp, which is compiled for AVX2 regardless of the build flags.
+namespace avx2 {
+    BlendRowProc RowProc(GBlendMode mode);
+    BlendColorProc ColorProc(GBlendMode mode);
+    BlendRowCoverageProc RowCoverageProc(GBlendMode mode);
+    BlendColorCoverageProc ColorCoverageProc(GBlendMode mode);
+}
+
+static bool cpu_has_avx2() {
+    static const bool hasAVX2 = __builtin_cpu_supports("avx2");
+    return hasAVX2;
+}
+#endif
+
+BlendRowProc GetBlendRowProc(GBlendMode mode) {
+#ifdef G_BLEND_X86
+    return cpu_has_avx2() ? avx2::RowProc(mode) : sse2::RowProc(mode);
+#else
+    return portable::RowProc(mode);
+#endif
+}
+
+BlendColorProc GetBlendColorProc(GBlendMode mode) {
+#ifdef G_BLEND_X86
+    return cpu_has_avx2() ? avx2::ColorProc(mode) : sse2::ColorProc(mode);
+#else
+    return portable::ColorProc(mode);
+#endif
+}
+
+BlendRowCoverageProc GetBlendRowCoverageProc(GBlendMode mode) {
+#ifdef G_BLEND_X86
+    return cpu_has_avx2() ? avx2::RowCoverageProc(mode) : sse2::RowCoverageProc(mode);
+#else
+    return portable::RowCoverageProc(mode);
+#endif
+}
+
+BlendColorCoverageProc GetBlendColorCoverageProc(GBlendMode mode) {
+#ifdef G_BLEND_X86
+    return cpu_has_avx2() ? avx2::ColorCoverageProc(mode) : sse2::ColorCoverageProc(mode);
+#else
+    return portable::ColorCoverageProc(mode);
+#endif
+}
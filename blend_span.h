@@ -0,0 +1,41 @@
+/*
+ *  Copyright 2024 Tyler Roth
+ */
+
+#ifndef _g_blend_span_h_
+#define _g_blend_span_h_
+
+#include "include/GBlendMode.h"
+#include "include/GPixel.h"
+#include <stdint.h>
+
+/**
+ *  Blend a whole row of pixels into dst. BlendRowProc reads one src pixel per dst pixel,
+ *  BlendColorProc blends the same src pixel into every dst pixel.
+ *
+ *  Results are bit-exact with blendColors() in my_blend.h.
+ */
+typedef void (*BlendRowProc)(GPixel dst[], const GPixel src[], int count);
+typedef void (*BlendColorProc)(GPixel dst[], GPixel src, int count);
+
+/**
+ *  Return the span kernel for the mode. The widest instruction set the cpu supports
+ *  (AVX2, else SSE2, else scalar) is picked the first time these are called.
+ */
+BlendRowProc GetBlendRowProc(GBlendMode mode);
+BlendColorProc GetBlendColorProc(GBlendMode mode);
+
+/**
+ *  The same blends for pixels that are only partly covered: each result is
+ *  lerp(dst, blend(src, dst), coverage / 255), so a coverage of 255 matches the procs above
+ *  and a coverage of 0 leaves dst alone.
+ */
+typedef void (*BlendRowCoverageProc)(GPixel dst[], const GPixel src[], const uint8_t coverage[],
+                                     int count);
+typedef void (*BlendColorCoverageProc)(GPixel dst[], GPixel src, const uint8_t coverage[],
+                                       int count);
+
+BlendRowCoverageProc GetBlendRowCoverageProc(GBlendMode mode);
+BlendColorCoverageProc GetBlendColorCoverageProc(GBlendMode mode);
+
+#endif
@@ -0,0 +1,72 @@
+/*
+ *  Copyright 2024 Tyler Roth
+ */
+
+#include "blend_span.h"
+#include <string.h>
+
+#if defined(__SSE2__)
+
+#include <immintrin.h>
+
+// Everything below is compiled for AVX2 no matter what the Makefile passes, so every header
+// has to be included above this point (otherwise their inline functions would be built for
+// AVX2 too). blend_span.cpp only calls in here after checking the cpu.
+#if defined(__clang__)
+    #pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#else
+    #pragma GCC push_options
+    #pragma GCC target("avx2")
+#endif
+
+namespace avx2 {
+    // Eight pixels at a time; the same math as sse2::Ops, on 256-bit registers.
+    struct Ops {
+        typedef __m256i V;
+        static constexpr int N = 8;
+
+        static V load(const GPixel* p) { return _mm256_loadu_si256((const __m256i*)p); }
+        static void store(GPixel* p, V v) { _mm256_storeu_si256((__m256i*)p, v); }
+        static V splat(GPixel p) { return _mm256_set1_epi32((int)p); }
+        static V zero() { return _mm256_setzero_si256(); }
+
+        static V alpha(V v) {
+            V a = _mm256_srli_epi32(v, GPIXEL_SHIFT_A);
+            a = _mm256_or_si256(a, _mm256_slli_epi32(a, 8));
+            return _mm256_or_si256(a, _mm256_slli_epi32(a, 16));
+        }
+
+        static V inv(V v) { return _mm256_xor_si256(v, _mm256_set1_epi32(-1)); }
+
+        static V mul16(V x, V a) {
+            V prod = _mm256_add_epi16(_mm256_mullo_epi16(x, a), _mm256_set1_epi16(128));
+            return _mm256_srli_epi16(_mm256_add_epi16(prod, _mm256_srli_epi16(prod, 8)), 8);
+        }
+
+        // unpack and pack both work within each 128-bit half, so pixel order is preserved
+        static V mul(V x, V a) {
+            const V z = _mm256_setzero_si256();
+            V lo = mul16(_mm256_unpacklo_epi8(x, z), _mm256_unpacklo_epi8(a, z));
+            V hi = mul16(_mm256_unpackhi_epi8(x, z), _mm256_unpackhi_epi8(a, z));
+            return _mm256_packus_epi16(lo, hi);
+        }
+
+        static V add(V x, V y) { return _mm256_add_epi32(x, y); }
+
+        static V coverage(const uint8_t* c) {
+            V v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)c));
+            v = _mm256_or_si256(v, _mm256_slli_epi32(v, 8));
+            return _mm256_or_si256(v, _mm256_slli_epi32(v, 16));
+        }
+    };
+
+    #include "blend_span_impl.h"
+}
+
+#if defined(__clang__)
+    #pragma clang attribute pop
+#else
+    #pragma GCC pop_options
+#endif
+
+#endif
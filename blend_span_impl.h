@@ -0,0 +1,206 @@
+/*
+ *  Copyright 2024 Tyler Roth
+ */
+
+// No include guard: this is included once per instruction set, inside that set's namespace,
+// after the namespace has defined its vector type "Ops". Ops provides
+//
+//      V               vector of Ops::N pixels
+//      load/store      N pixels from/to memory
+//      splat(p)        p in every lane
+//      zero()          all zeros
+//      alpha(v)        each pixel's alpha copied into all four of its channels
+//      inv(v)          255 - v per channel
+//      mul(x, a)       x * a / 255 per channel, rounded the same way as quad_mul_div255
+//      add(x, y)       x + y per 32-bit pixel, carries included (same as GPixel + GPixel)
+//      coverage(c)     N coverage bytes, each copied into all four channels of its pixel
+
+template <GBlendMode M> static inline Ops::V blend(Ops::V s, Ops::V d) {
+    switch (M) {
+        case GBlendMode::kClear:
+            return Ops::zero();
+        case GBlendMode::kSrc:
+            return s;
+        case GBlendMode::kDst:
+            return d;
+        case GBlendMode::kSrcOver:
+            return Ops::add(s, Ops::mul(d, Ops::inv(Ops::alpha(s))));
+        case GBlendMode::kDstOver:
+            return Ops::add(d, Ops::mul(s, Ops::inv(Ops::alpha(d))));
+        case GBlendMode::kSrcIn:
+            return Ops::mul(s, Ops::alpha(d));
+        case GBlendMode::kDstIn:
+            return Ops::mul(d, Ops::alpha(s));
+        case GBlendMode::kSrcOut:
+            return Ops::mul(s, Ops::inv(Ops::alpha(d)));
+        case GBlendMode::kDstOut:
+            return Ops::mul(d, Ops::inv(Ops::alpha(s)));
+        case GBlendMode::kSrcATop:
+            return Ops::add(Ops::mul(s, Ops::alpha(d)), Ops::mul(d, Ops::inv(Ops::alpha(s))));
+        case GBlendMode::kDstATop:
+            return Ops::add(Ops::mul(d, Ops::alpha(s)), Ops::mul(s, Ops::inv(Ops::alpha(d))));
+        case GBlendMode::kXor:
+            return Ops::add(Ops::mul(d, Ops::inv(Ops::alpha(s))), Ops::mul(s, Ops::inv(Ops::alpha(d))));
+    }
+    return Ops::zero();
+}
+
+// mul(b, c) + mul(d, 255 - c) never carries out of a channel: the two rounded halves of a
+// channel always add back up to at most the larger of b and d.
+template <GBlendMode M> static inline Ops::V blend_coverage(Ops::V s, Ops::V d, Ops::V c) {
+    return Ops::add(Ops::mul(blend<M>(s, d), c), Ops::mul(d, Ops::inv(c)));
+}
+
+// The last (count % N) pixels go through a small stack buffer so they can use the same kernel.
+template <GBlendMode M> static void blend_row(GPixel dst[], const GPixel src[], int count) {
+    int i = 0;
+    for (; i + Ops::N <= count; i += Ops::N) {
+        Ops::store(dst + i, blend<M>(Ops::load(src + i), Ops::load(dst + i)));
+    }
+
+    if (i < count) {
+        const int rest = count - i;
+        GPixel s[Ops::N] = {};
+        GPixel d[Ops::N] = {};
+        memcpy(s, src + i, rest * sizeof(GPixel));
+        memcpy(d, dst + i, rest * sizeof(GPixel));
+        Ops::store(d, blend<M>(Ops::load(s), Ops::load(d)));
+        memcpy(dst + i, d, rest * sizeof(GPixel));
+    }
+}
+
+template <GBlendMode M> static void blend_color(GPixel dst[], GPixel src, int count) {
+    const Ops::V s = Ops::splat(src);
+
+    int i = 0;
+    for (; i + Ops::N <= count; i += Ops::N) {
+        Ops::store(dst + i, blend<M>(s, Ops::load(dst + i)));
+    }
+
+    if (i < count) {
+        const int rest = count - i;
+        GPixel d[Ops::N] = {};
+        memcpy(d, dst + i, rest * sizeof(GPixel));
+        Ops::store(d, blend<M>(s, Ops::load(d)));
+        memcpy(dst + i, d, rest * sizeof(GPixel));
+    }
+}
+
+template <GBlendMode M>
+static void blend_row_coverage(GPixel dst[], const GPixel src[], const uint8_t coverage[],
+                               int count) {
+    int i = 0;
+    for (; i + Ops::N <= count; i += Ops::N) {
+        Ops::store(dst + i, blend_coverage<M>(Ops::load(src + i), Ops::load(dst + i),
+                                              Ops::coverage(coverage + i)));
+    }
+
+    if (i < count) {
+        const int rest = count - i;
+        GPixel s[Ops::N] = {};
+        GPixel d[Ops::N] = {};
+        uint8_t c[Ops::N] = {};
+        memcpy(s, src + i, rest * sizeof(GPixel));
+        memcpy(d, dst + i, rest * sizeof(GPixel));
+        memcpy(c, coverage + i, rest);
+        Ops::store(d, blend_coverage<M>(Ops::load(s), Ops::load(d), Ops::coverage(c)));
+        memcpy(dst + i, d, rest * sizeof(GPixel));
+    }
+}
+
+template <GBlendMode M>
+static void blend_color_coverage(GPixel dst[], GPixel src, const uint8_t coverage[], int count) {
+    const Ops::V s = Ops::splat(src);
+
+    int i = 0;
+    for (; i + Ops::N <= count; i += Ops::N) {
+        Ops::store(dst + i, blend_coverage<M>(s, Ops::load(dst + i), Ops::coverage(coverage + i)));
+    }
+
+    if (i < count) {
+        const int rest = count - i;
+        GPixel d[Ops::N] = {};
+        uint8_t c[Ops::N] = {};
+        memcpy(d, dst + i, rest * sizeof(GPixel));
+        memcpy(c, coverage + i, rest);
+        Ops::store(d, blend_coverage<M>(s, Ops::load(d), Ops::coverage(c)));
+        memcpy(dst + i, d, rest * sizeof(GPixel));
+    }
+}
+
+// Indexed by GBlendMode.
+static const BlendRowProc gRowProcs[] = {
+    blend_row<GBlendMode::kClear>,
+    blend_row<GBlendMode::kSrc>,
+    blend_row<GBlendMode::kDst>,
+    blend_row<GBlendMode::kSrcOver>,
+    blend_row<GBlendMode::kDstOver>,
+    blend_row<GBlendMode::kSrcIn>,
+    blend_row<GBlendMode::kDstIn>,
+    blend_row<GBlendMode::kSrcOut>,
+    blend_row<GBlendMode::kDstOut>,
+    blend_row<GBlendMode::kSrcATop>,
+    blend_row<GBlendMode::kDstATop>,
+    blend_row<GBlendMode::kXor>,
+};
+
+static const BlendColorProc gColorProcs[] = {
+    blend_color<GBlendMode::kClear>,
+    blend_color<GBlendMode::kSrc>,
+    blend_color<GBlendMode::kDst>,
+    blend_color<GBlendMode::kSrcOver>,
+    blend_color<GBlendMode::kDstOver>,
+    blend_color<GBlendMode::kSrcIn>,
+    blend_color<GBlendMode::kDstIn>,
+    blend_color<GBlendMode::kSrcOut>,
+    blend_color<GBlendMode::kDstOut>,
+    blend_color<GBlendMode::kSrcATop>,
+    blend_color<GBlendMode::kDstATop>,
+    blend_color<GBlendMode::kXor>,
+};
+
+static const BlendRowCoverageProc gRowCoverageProcs[] = {
+    blend_row_coverage<GBlendMode::kClear>,
+    blend_row_coverage<GBlendMode::kSrc>,
+    blend_row_coverage<GBlendMode::kDst>,
+    blend_row_coverage<GBlendMode::kSrcOver>,
+    blend_row_coverage<GBlendMode::kDstOver>,
+    blend_row_coverage<GBlendMode::kSrcIn>,
+    blend_row_coverage<GBlendMode::kDstIn>,
+    blend_row_coverage<GBlendMode::kSrcOut>,
+    blend_row_coverage<GBlendMode::kDstOut>,
+    blend_row_coverage<GBlendMode::kSrcATop>,
+    blend_row_coverage<GBlendMode::kDstATop>,
+    blend_row_coverage<GBlendMode::kXor>,
+};
+
+static const BlendColorCoverageProc gColorCoverageProcs[] = {
+    blend_color_coverage<GBlendMode::kClear>,
+    blend_color_coverage<GBlendMode::kSrc>,
+    blend_color_coverage<GBlendMode::kDst>,
+    blend_color_coverage<GBlendMode::kSrcOver>,
+    blend_color_coverage<GBlendMode::kDstOver>,
+    blend_color_coverage<GBlendMode::kSrcIn>,
+    blend_color_coverage<GBlendMode::kDstIn>,
+    blend_color_coverage<GBlendMode::kSrcOut>,
+    blend_color_coverage<GBlendMode::kDstOut>,
+    blend_color_coverage<GBlendMode::kSrcATop>,
+    blend_color_coverage<GBlendMode::kDstATop>,
+    blend_color_coverage<GBlendMode::kXor>,
+};
+
+BlendRowProc RowProc(GBlendMode mode) {
+    return gRowProcs[(int)mode];
+}
+
+BlendColorProc ColorProc(GBlendMode mode) {
+    return gColorProcs[(int)mode];
+}
+
+BlendRowCoverageProc RowCoverageProc(GBlendMode mode) {
+    return gRowCoverageProcs[(int)mode];
+}
+
+BlendColorCoverageProc ColorCoverageProc(GBlendMode mode) {
+    return gColorCoverageProcs[(int)mode];
+}
@@ -0,0 +1,299 @@
+/*
+ *  Copyright 2024 Tyler Roth
+ */
+
+#ifndef _g_blitter_h_
+#define _g_blitter_h_
+
+#include "include/GBitmap.h"
+#include "include/GBlendMode.h"
+#include "include/GMatrix.h"
+#include "include/GPaint.h"
+#include "include/GPixel.h"
+#include "include/GRect.h"
+#include "include/GShader.h"
+#include "blend_span.h"
+#include "deferred_clear.h"
+#include "GEdge.h"
+#include "my_utils.h"
+
+/**
+ *  Fills spans of the device with a paint. All of the per-paint work (blend mode, shader
+ *  context, src color) is done once when the blitter is made, so a draw call makes one of
+ *  these and then feeds it every span it produces.
+ *
+ *  If the canvas has a deferred clear pending, each row is cleared right before the blitter
+ *  first writes into it.
+ */
+class Blitter {
+public:
+    /**
+     *  shadeBuffer must have room for a full device row; it holds the shader's output for
+     *  each span.
+     */
+    Blitter(const GBitmap& device, const GPaint& paint, const GMatrix& ctm, GPixel shadeBuffer[],
+            DeferredClear* deferredClear = nullptr)
+            : fDevice(device), fClip(GIRect::WH(device.width(), device.height())), fShaded(shadeBuffer) {
+        if (deferredClear && deferredClear->isPending()) {
+            fDeferredClear = deferredClear;
+        }
+
+        GBlendMode mode = paint.getBlendMode();
+        fShader = paint.peekShader();
+
+        if (fShader) {
+            if (!fShader->setContext(ctm)) {
+                fRowProc = &Blitter::blitNothing;
+                return;
+            }
+
+            mode = ReduceMode(mode, fShader->isOpaque() ? kOpaque_SrcAlpha : kUnknown_SrcAlpha);
+            if (mode != GBlendMode::kDst && mode != GBlendMode::kClear) {
+                fRowProc = &Blitter::blitShader;
+                fCoverageProc = &Blitter::blitShaderCoverage;
+                fBlendRow = GetBlendRowProc(mode);
+                fBlendRowCoverage = GetBlendRowCoverageProc(mode);
+                return;
+            }
+        } else {
+            fColor = color_to_pixel(paint.getColor());
+
+            SrcAlpha srcAlpha = kUnknown_SrcAlpha;
+            if (GPixel_GetA(fColor) == 0) {
+                srcAlpha = kZero_SrcAlpha;
+            } else if (GPixel_GetA(fColor) == 0xFF) {
+                srcAlpha = kOpaque_SrcAlpha;
+            }
+            mode = ReduceMode(mode, srcAlpha);
+        }
+
+        if (mode == GBlendMode::kDst) {
+            fRowProc = &Blitter::blitNothing;
+        } else {
+            if (mode == GBlendMode::kClear) {
+                fColor = 0;
+                mode = GBlendMode::kSrc;
+            }
+            fRowProc = &Blitter::blitColor;
+            fCoverageProc = &Blitter::blitColorCoverage;
+            fBlendColor = GetBlendColorProc(mode);
+            fBlendColorCoverage = GetBlendColorCoverageProc(mode);
+        }
+    }
+
+    /**
+     *  A copy that shades into its own buffer (room for a device row), so the two can blit
+     *  on different threads.
+     */
+    Blitter(const Blitter& other, GPixel shadeBuffer[]) : Blitter(other) {
+        fShaded = shadeBuffer;
+    }
+
+    // True if drawing with this paint can not change any pixels, so the draw can be skipped.
+    bool isNoop() const { return fRowProc == &Blitter::blitNothing; }
+
+    /**
+     *  Only write the pixels inside clip (which must be inside the device) from now on. Every
+     *  span is trimmed to it as it comes in, so the scanners need not know about it.
+     */
+    void setClip(const GIRect& clip) { fClip = clip; }
+
+    // Fill the pixels [xLeft ... xRight) on row y, clamped to the clip.
+    void blitRow(int y, int xLeft, int xRight) {
+        xLeft = std::max(fClip.left, xLeft);
+        xRight = std::min(fClip.right, xRight);
+
+        if (xLeft < xRight && y >= fClip.top && y < fClip.bottom) {
+            if (fDeferredClear) {
+                fDeferredClear->resolveRow(fDevice, y);
+            }
+            (this->*fRowProc)(y, xLeft, xRight - xLeft);
+        }
+    }
+
+    /**
+     *  True if copies of this blitter, each with its own shade buffer, may blit different
+     *  pixels from several threads at once. That holds unless the shader says otherwise.
+     */
+    bool isThreadSafe() const { return fRowProc != &Blitter::blitShader || fShader->isThreadSafe(); }
+
+    /**
+     *  Write any pending deferred clear for rows [top, bottom) now. After this, blitting into
+     *  those rows no longer touches the deferred clear's state, so it may happen on any thread.
+     */
+    void resolveRows(int top, int bottom) {
+        if (fDeferredClear) {
+            fDeferredClear->resolveRows(fDevice, top, bottom);
+        }
+    }
+
+    // The rows a scanner may pass to blitFixedRow().
+    int height() const { return fDevice.height(); }
+
+    // Same as blitRow(), for a span whose ends are still in 16.16.
+    void blitFixedRow(int y, GFixed xLeft, GFixed xRight) {
+        this->blitRow(y, fixed_round_to_int(xLeft), fixed_round_to_int(xRight));
+    }
+
+    /**
+     *  Fill the pixels [x ... x + count) on row y, which must be inside the device, with
+     *  partial coverage (0 = untouched ... 255 = same as blitRow), trimmed to the clip. Fully
+     *  covered and uncovered runs skip the coverage math.
+     */
+    void blitAntiRow(int y, int x, int count, const uint8_t coverage[]) {
+        assert(x >= 0 && x + count <= fDevice.width());
+
+        if (y < fClip.top || y >= fClip.bottom) {
+            return;
+        }
+        if (x < fClip.left) {
+            coverage += fClip.left - x;
+            count -= fClip.left - x;
+            x = fClip.left;
+        }
+        count = std::min(count, fClip.right - x);
+        if (count <= 0) {
+            return;
+        }
+
+        if (fDeferredClear) {
+            fDeferredClear->resolveRow(fDevice, y);
+        }
+
+        int i = 0;
+        while (i < count) {
+            const int start = i;
+            const uint8_t c = coverage[i];
+
+            if (c == 0 || c == 0xFF) {
+                while (i < count && coverage[i] == c) {
+                    i++;
+                }
+                if (c == 0xFF) {
+                    (this->*fRowProc)(y, x + start, i - start);
+                }
+            } else {
+                while (i < count && coverage[i] != 0 && coverage[i] != 0xFF) {
+                    i++;
+                }
+                (this->*fCoverageProc)(y, x + start, i - start, coverage + start);
+            }
+        }
+    }
+
+    // Fill every pixel of the rect (which must already be inside the device) that is in the clip.
+    void blitRect(GIRect r) {
+        assert(r.left >= 0 && r.top >= 0 && r.right <= fDevice.width() && r.bottom <= fDevice.height());
+
+        r = GIRect::LTRB(std::max(r.left, fClip.left), std::max(r.top, fClip.top),
+                         std::min(r.right, fClip.right), std::min(r.bottom, fClip.bottom));
+        if (r.isEmpty()) {
+            return;
+        }
+
+        this->resolveRows(r.top, r.bottom);
+
+        // rows that span the whole (tightly packed) device are one contiguous run of pixels
+        if (fRowProc == &Blitter::blitColor && r.width() == fDevice.width() &&
+            fDevice.rowBytes() == fDevice.width() * sizeof(GPixel)) {
+            fBlendColor(fDevice.getAddr(0, r.top), fColor, r.width() * r.height());
+            return;
+        }
+
+        for (int y = r.top; y < r.bottom; ++y) {
+            (this->*fRowProc)(y, r.left, r.width());
+        }
+    }
+
+private:
+    enum SrcAlpha {
+        kUnknown_SrcAlpha,
+        kZero_SrcAlpha,
+        kOpaque_SrcAlpha,
+    };
+
+    /**
+     *  Rewrite the mode into a cheaper one that gives identical pixels when every src pixel
+     *  has the given alpha. kDst means the draw does nothing and kClear means it zeros dst.
+     */
+    static GBlendMode ReduceMode(GBlendMode mode, SrcAlpha srcAlpha) {
+        if (srcAlpha == kZero_SrcAlpha) {
+            switch (mode) {
+                case GBlendMode::kSrcOver:
+                case GBlendMode::kDstOver:
+                case GBlendMode::kDstOut:
+                case GBlendMode::kSrcATop:
+                case GBlendMode::kXor:
+                    return GBlendMode::kDst;
+                case GBlendMode::kSrc:
+                case GBlendMode::kSrcIn:
+                case GBlendMode::kDstIn:
+                case GBlendMode::kSrcOut:
+                case GBlendMode::kDstATop:
+                    return GBlendMode::kClear;
+                default:
+                    return mode;
+            }
+        }
+
+        if (srcAlpha == kOpaque_SrcAlpha) {
+            switch (mode) {
+                case GBlendMode::kSrcOver:
+                    return GBlendMode::kSrc;
+                case GBlendMode::kDstIn:
+                    return GBlendMode::kDst;
+                case GBlendMode::kDstOut:
+                    return GBlendMode::kClear;
+                case GBlendMode::kSrcATop:
+                    return GBlendMode::kSrcIn;
+                case GBlendMode::kDstATop:
+                    return GBlendMode::kDstOver;
+                case GBlendMode::kXor:
+                    return GBlendMode::kSrcOut;
+                default:
+                    return mode;
+            }
+        }
+
+        return mode;
+    }
+
+    void blitNothing(int y, int x, int count) {}
+
+    void blitColor(int y, int x, int count) {
+        fBlendColor(fDevice.getAddr(x, y), fColor, count);
+    }
+
+    void blitShader(int y, int x, int count) {
+        fShader->shadeRow(x, y, count, fShaded);
+        fBlendRow(fDevice.getAddr(x, y), fShaded, count);
+    }
+
+    void blitNothingCoverage(int y, int x, int count, const uint8_t coverage[]) {}
+
+    void blitColorCoverage(int y, int x, int count, const uint8_t coverage[]) {
+        fBlendColorCoverage(fDevice.getAddr(x, y), fColor, coverage, count);
+    }
+
+    void blitShaderCoverage(int y, int x, int count, const uint8_t coverage[]) {
+        fShader->shadeRow(x, y, count, fShaded);
+        fBlendRowCoverage(fDevice.getAddr(x, y), fShaded, coverage, count);
+    }
+
+    const GBitmap&          fDevice;
+    GIRect                  fClip;
+    GShader*                fShader = nullptr;
+    GPixel                  fColor = 0;
+    BlendColorProc          fBlendColor = nullptr;
+    BlendRowProc            fBlendRow = nullptr;
+    BlendColorCoverageProc  fBlendColorCoverage = nullptr;
+    BlendRowCoverageProc    fBlendRowCoverage = nullptr;
+    GPixel*                 fShaded;
+    DeferredClear*          fDeferredClear = nullptr;
+
+    void (Blitter::*fRowProc)(int y, int x, int count);
+    void (Blitter::*fCoverageProc)(int y, int x, int count, const uint8_t coverage[]) =
+            &Blitter::blitNothingCoverage;
+};
+
+#endif
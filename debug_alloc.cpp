@@ -0,0 +1,40 @@
+/*
+ *  Copyright 2024 Tyler Roth
+ */
+
+#include "debug_alloc.h"
+
+#ifdef NDEBUG
+
+int64_t debugAllocationCount() { return 0; }
+
+#else
+
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+static std::atomic<int64_t> gAllocationCount{0};
+
+int64_t debugAllocationCount() {
+    return gAllocationCount.load(std::memory_order_relaxed);
+}
+
+// libstdc++ sends the array and nothrow forms of new and delete through these.
+void* operator new(size_t size) {
+    gAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+#endif
@@ -0,0 +1,20 @@
+/*
+ *  Copyright 2024 Tyler Roth
+ */
+
+#ifndef _g_debug_alloc_h_
+#define _g_debug_alloc_h_
+
+#include <stdint.h>
+
+/**
+ *  Debugging aid: how many times operator new has run so far, on any thread. Reading it
+ *  before and after a draw shows whether the draw went to the heap; once a scene has been
+ *  drawn, drawing it again on the same canvas should leave it unchanged.
+ *
+ *  Only debug builds (without NDEBUG) count; release builds keep the default operator new
+ *  and always return 0.
+ */
+int64_t debugAllocationCount();
+
+#endif
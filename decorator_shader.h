@@ -26,6 +26,10 @@ class DecoratorShader : public GShader {
             return fOgShader->setContext(ctm * fNewTransformation);
         }
 
+        bool isThreadSafe() override {
+            return fOgShader->isThreadSafe();
+        }
+
         void shadeRow(int x, int y, int count, GPixel row[]) override {
             fOgShader->shadeRow(x, y, count, row);
         }
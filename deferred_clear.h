@@ -0,0 +1,78 @@
+/*
+ *  Copyright 2024 Tyler Roth
+ */
+
+#ifndef _g_deferred_clear_h_
+#define _g_deferred_clear_h_
+
+#include "include/GBitmap.h"
+#include "include/GBlendMode.h"
+#include "include/GPixel.h"
+#include "blend_span.h"
+#include <vector>
+
+/**
+ *  Write color into every pixel of the bitmap. When the rows are tightly packed the whole
+ *  bitmap is filled as one span.
+ */
+static inline void clear_bitmap(const GBitmap& bitmap, GPixel color) {
+    BlendColorProc fill = GetBlendColorProc(GBlendMode::kSrc);
+
+    if (bitmap.rowBytes() == bitmap.width() * sizeof(GPixel)) {
+        fill(bitmap.pixels(), color, bitmap.width() * bitmap.height());
+        return;
+    }
+
+    for (int y = 0; y < bitmap.height(); ++y) {
+        fill(bitmap.getAddr(0, y), color, bitmap.width());
+    }
+}
+
+/**
+ *  A clear that has been recorded but not yet written. Each row is written the first time
+ *  something draws into it (resolveRow), and any rows nobody touched are written by flush().
+ */
+class DeferredClear {
+public:
+    bool isPending() const { return fPendingRows > 0; }
+
+    // Mark every row of the bitmap as waiting for color.
+    void record(const GBitmap& bitmap, GPixel color) {
+        fColor = color;
+        fRowIsPending.assign(bitmap.height(), true);
+        fPendingRows = bitmap.height();
+    }
+
+    // Forget the recorded clear, e.g. because the whole bitmap was just written.
+    void discard() {
+        fRowIsPending.clear();
+        fPendingRows = 0;
+    }
+
+    // Call before writing any pixel in row y.
+    void resolveRow(const GBitmap& bitmap, int y) {
+        if (fRowIsPending[y]) {
+            GetBlendColorProc(GBlendMode::kSrc)(bitmap.getAddr(0, y), fColor, bitmap.width());
+            fRowIsPending[y] = false;
+            fPendingRows -= 1;
+        }
+    }
+
+    void resolveRows(const GBitmap& bitmap, int top, int bottom) {
+        for (int y = top; y < bottom && fPendingRows > 0; ++y) {
+            this->resolveRow(bitmap, y);
+        }
+    }
+
+    void flush(const GBitmap& bitmap) {
+        this->resolveRows(bitmap, 0, bitmap.height());
+        this->discard();
+    }
+
+private:
+    GPixel            fColor = 0;
+    std::vector<bool> fRowIsPending;
+    int               fPendingRows = 0;
+};
+
+#endif
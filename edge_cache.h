@@ -0,0 +1,135 @@
+/*
+ *  Copyright 2024 Tyler Roth
+ */
+
+#ifndef _g_edge_cache_h_
+#define _g_edge_cache_h_
+
+#include "include/GMatrix.h"
+#include "include/GPath.h"
+#include "GEdge.h"
+#include <math.h>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+/**
+ *  Edge lists (sorted, lines only) that were built for recently drawn paths, kept by the
+ *  path's uniqueID so drawing the same path again can skip building and sorting its edges.
+ *
+ *  A draw under the matrix the edges were built with reuses them as they are. A draw whose
+ *  matrix differs from it only by a whole-pixel translation reuses them moved, as long as
+ *  the path is inside the device both times (otherwise the device would have clipped the two
+ *  differently). Each path keeps one list, for the last matrix it missed with, and the least
+ *  recently used lists are dropped to stay within the memory budget.
+ */
+class EdgeCache {
+public:
+    explicit EdgeCache(size_t budget) : fBudget(budget) {}
+
+    /**
+     *  Copy path's edges under ctm into edges, if they are cached, and return true. rows is
+     *  the height the edges are clipped to and unclipped says whether the path is inside the
+     *  device under ctm.
+     */
+    bool find(const GPath& path, const GMatrix& ctm, int rows, bool unclipped,
+              std::vector<Edge>& edges) {
+        auto found = fIndex.find(path.uniqueID());
+        int dx, dy;
+        if (found == fIndex.end() || !found->second->matches(ctm, rows, unclipped, &dx, &dy)) {
+            fMissCount++;
+            return false;
+        }
+
+        fEntries.splice(fEntries.begin(), fEntries, found->second);
+        fHitCount++;
+
+        const std::vector<Edge>& cached = found->second->edges;
+        edges.assign(cached.begin(), cached.end());
+        if (dx != 0 || dy != 0) {
+            const GFixed fixedDX = (GFixed)dx << kFixedShift;
+            for (Edge& edge : edges) {
+                edge.x += fixedDX;
+                edge.y0 += dy;
+                edge.y1 += dy;
+            }
+        }
+        return true;
+    }
+
+    // Remember the edges (sorted, lines only) built for path under ctm; see find().
+    void add(const GPath& path, const GMatrix& ctm, int rows, bool unclipped,
+             const std::vector<Edge>& edges) {
+        this->remove(path.uniqueID());
+
+        const size_t bytes = sizeof(Entry) + edges.size() * sizeof(Edge);
+        if (bytes > fBudget) {
+            return;
+        }
+        while (fBytesUsed + bytes > fBudget) {
+            this->remove(fEntries.back().id);
+        }
+
+        fEntries.push_front({path.uniqueID(), ctm, rows, unclipped, bytes, edges});
+        fIndex[path.uniqueID()] = fEntries.begin();
+        fBytesUsed += bytes;
+    }
+
+    int hitCount() const { return fHitCount; }
+    int missCount() const { return fMissCount; }
+    size_t bytesUsed() const { return fBytesUsed; }
+
+private:
+    struct Entry {
+        uint32_t            id;
+        GMatrix             ctm;
+        int                 rows;
+        bool                unclipped;
+        size_t              bytes;
+        std::vector<Edge>   edges;
+
+        // True if the edges can be drawn under ctm, moved by (dx, dy) whole pixels.
+        bool matches(const GMatrix& m, int mRows, bool mUnclipped, int* dx, int* dy) const {
+            if (mRows != rows) {
+                return false;
+            }
+            for (int i = 0; i < 4; ++i) {
+                if (m[i] != ctm[i]) {
+                    return false;
+                }
+            }
+
+            const float tx = m[4] - ctm[4];
+            const float ty = m[5] - ctm[5];
+            if (tx == 0 && ty == 0) {
+                *dx = *dy = 0;
+                return true;
+            }
+            if (!unclipped || !mUnclipped || tx != floorf(tx) || ty != floorf(ty)) {
+                return false;
+            }
+            *dx = (int)tx;
+            *dy = (int)ty;
+            return true;
+        }
+    };
+
+    // most recently used first
+    std::list<Entry>                                        fEntries;
+    std::unordered_map<uint32_t, std::list<Entry>::iterator> fIndex;
+    size_t  fBudget;
+    size_t  fBytesUsed = 0;
+    int     fHitCount = 0;
+    int     fMissCount = 0;
+
+    void remove(uint32_t id) {
+        auto found = fIndex.find(id);
+        if (found != fIndex.end()) {
+            fBytesUsed -= found->second->bytes;
+            fEntries.erase(found->second);
+            fIndex.erase(found);
+        }
+    }
+};
+
+#endif
@@ -35,10 +35,16 @@ public:
     std::shared_ptr<GShader> shareShader() const { return fShader; }
     GPaint&  setShader(std::shared_ptr<GShader> s) { fShader = s; return *this; }
 
+    // When set, path and polygon edges are drawn with partial coverage instead of snapping
+    // to whole pixels.
+    bool    isAntiAlias() const { return fAntiAlias; }
+    GPaint& setAntiAlias(bool aa) { fAntiAlias = aa; return *this; }
+
 private:
     GColor                      fColor = {0, 0, 0, 1};
     std::shared_ptr<GShader>    fShader;
     GBlendMode                  fMode = GBlendMode::kSrcOver;
+    bool                        fAntiAlias = false;
 };
 
 #endif
@@ -5,6 +5,7 @@
 #include "GPoint.h"
 #include "GRect.h"
 
+#include <atomic>
 #include <vector>
 
 enum GPathVerb {
@@ -26,10 +27,31 @@ public:
      *
      *  If there are no points, returns an empty rect (all zeros)
      */
-    GRect bounds() const;
+    GRect bounds() const { return fBounds; }
+
+    /**
+     *  A number no other path made by this process has (paths are immutable, so it can key
+     *  caches of work derived from this one). Never 0.
+     */
+    uint32_t uniqueID() const { return fUniqueID; }
 
     size_t countPoints() const { return fPts.size(); }
 
+    enum class Shape {
+        kRect,      // one axis-aligned rectangle, e.g. from GPathBuilder::addRect
+        kOval,      // one convex contour of four cubics between the ends of two axes,
+                    // e.g. from GPathBuilder::addCircle
+        kConvex,    // one contour turning the same way all the way around, e.g. addPolygon
+        kGeneral,   // anything else
+    };
+
+    /**
+     *  What kind of shape the path is. Worked out the first time it is asked for and then
+     *  remembered. Curves count as convex when their control points (taken with the rest
+     *  of the contour's points as one polygon) are, which keeps the curves convex too.
+     */
+    Shape shape() const;
+
     /**
      *  Create a new path by transforming the points in this path.
      */
@@ -115,6 +137,8 @@ public:
     GPath(std::vector<GPoint> pts, std::vector<GPathVerb> vbs)
         : fPts(std::move(pts))
         , fVbs(std::move(vbs))
+        , fBounds(ComputeBounds(fPts))
+        , fUniqueID(NextUniqueID())
     {}
 
 private:
@@ -125,6 +149,16 @@ private:
 
     const std::vector<GPoint>    fPts;
     const std::vector<GPathVerb> fVbs;
+
+    // computed once, when the path is made (e.g. by GPathBuilder::detach)
+    const GRect                  fBounds;
+    const uint32_t               fUniqueID;
+    // a Shape, or -1 until shape() has been called
+    mutable std::atomic<int>     fShape{-1};
+
+    static GRect ComputeBounds(const std::vector<GPoint>&);
+    static uint32_t NextUniqueID();
+    Shape computeShape() const;
 };
 
 #endif
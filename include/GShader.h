@@ -38,6 +38,12 @@ public:
      *  can hold at least [count] entries.
      */
     virtual void shadeRow(int x, int y, int count, GPixel row[]) = 0;
+
+    /**
+     *  Return true if, once setContext() has returned, shadeRow() may be called from several
+     *  threads at once, i.e. it only reads the state setContext() left behind.
+     */
+    virtual bool isThreadSafe() { return false; }
 };
 
 /**
@@ -26,6 +26,10 @@ class JoinedShader : public GShader {
             return fShader1->setContext(ctm) && fShader2->setContext(ctm);
         }
 
+        bool isThreadSafe() override {
+            return fShader1->isThreadSafe() && fShader2->isThreadSafe();
+        }
+
         void shadeRow(int x, int y, int count, GPixel row[]) override {
             GPixel row1[count];
             GPixel row2[count];
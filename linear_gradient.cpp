@@ -47,6 +47,8 @@ public:
         return true;
     };
 
+    bool isThreadSafe() override { return true; }
+
     void shadeRow(int x, int y, int count, GPixel row[]) override {
         GPoint point = { x + 0.5f, y + 0.5f };
         GPoint dst = fInverseCTM * point;
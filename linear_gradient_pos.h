@@ -50,6 +50,8 @@ class LinearGradientPos : public GShader {
             return true;
         };
 
+        bool isThreadSafe() override { return true; }
+
         void shadeRow(int x, int y, int count, GPixel row[]) override {
             GPoint point = { x + 0.5f, y + 0.5f };
             GPoint dst = fInverseCTM * point;
@@ -0,0 +1,228 @@
+/*
+ *  Copyright 2024 Tyler Roth
+ */
+
+#ifndef _g_path_tiler_h_
+#define _g_path_tiler_h_
+
+#include "blitter.h"
+#include "GEdge.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <vector>
+
+/**
+ *  Scan converts a path's edges (nonzero winding) as a grid of kTileSize x kTileSize tiles,
+ *  so the work of one big path can be spread over a ThreadPool.
+ *
+ *  Rows of tiles ("bands") are binned first, one band per task: every row of every edge in
+ *  the band is placed in the tile its rounded x falls in, and its winding is added to a
+ *  per-row "backdrop" for every tile to its right. Then each tile is its own task: it starts
+ *  each row with the backdrop's winding and only sorts the edges that cross it.
+ *
+ *  A pixel is filled exactly when the serial scan (MyCanvas::pathScan) would fill it. The
+ *  bins are kept from one scan to the next and only ever grow, so a tiler kept by the canvas
+ *  stops allocating once it has seen the largest path.
+ */
+class PathTiler {
+public:
+    static constexpr int kTileShift = 6;
+    static constexpr int kTileSize = 1 << kTileShift;
+
+    /**
+     *  Fill the edges (in any order) on device rows [0, height) and columns [0, width).
+     *  blitters holds one blitter per pool thread, each with its own shade buffer (see
+     *  Blitter::isThreadSafe).
+     */
+    void scan(const std::vector<Edge>& edges, int width, int height, Blitter blitters[],
+              ThreadPool& pool) {
+        int top = height, bottom = 0;
+        for (const Edge& edge : edges) {
+            if (edge.y0 < edge.y1) {
+                top = std::min(top, edge.y0);
+                bottom = std::max(bottom, edge.y1);
+            }
+        }
+        top = std::max(top, 0);
+        bottom = std::min(bottom, height);
+        if (top >= bottom) {
+            return;
+        }
+
+        fEdges = &edges;
+        fWidth = width;
+        fColumns = (width + kTileSize - 1) >> kTileShift;
+        fFirstBand = top >> kTileShift;
+        fTop = top;
+        fBottom = bottom;
+
+        const int bandCount = ((bottom - 1) >> kTileShift) - fFirstBand + 1;
+        if ((int)fBands.size() < bandCount) {
+            fBands.resize(bandCount);
+        }
+        for (int b = 0; b < bandCount; ++b) {
+            fBands[b].edges.clear();
+        }
+
+        for (int i = 0; i < (int)edges.size(); ++i) {
+            const Edge& edge = edges[i];
+            const int first = std::max(edge.y0, top) >> kTileShift;
+            const int last = (std::min(edge.y1, bottom) - 1) >> kTileShift;
+            for (int b = first; b <= last; ++b) {
+                fBands[b - fFirstBand].edges.push_back(i);
+            }
+        }
+
+        // the rows being drawn may be written by any thread from here on
+        blitters[0].resolveRows(top, bottom);
+
+        pool.parallelFor(bandCount, [this](int b, int) { this->binBand(b); });
+
+        fTiles.clear();
+        for (int b = 0; b < bandCount; ++b) {
+            for (int col = 0; col < fColumns; ++col) {
+                if (fBands[b].tileIsUsed[col]) {
+                    fTiles.push_back({b, col});
+                }
+            }
+        }
+
+        if ((int)fCrossings.size() < pool.threadCount()) {
+            fCrossings.resize(pool.threadCount());
+        }
+        // room for every edge on every thread, whichever tiles each one ends up with
+        for (std::vector<Crossing>& crossings : fCrossings) {
+            crossings.reserve(edges.size());
+        }
+
+        pool.parallelFor((int)fTiles.size(), [this, blitters](int t, int thread) {
+            this->scanTile(fTiles[t].band, fTiles[t].column, blitters[thread], fCrossings[thread]);
+        });
+    }
+
+private:
+    struct Band {
+        std::vector<int>                edges;          // indices into fEdges
+        std::vector<int>                backdrop;       // kTileSize rows of (fColumns + 1)
+        std::vector<std::vector<int>>   tileEdges;      // per column, edges that cross it
+        std::vector<bool>               tileIsUsed;     // per column
+    };
+
+    struct Tile {
+        int band, column;
+    };
+
+    struct Crossing {
+        int x, wind;
+    };
+
+    const std::vector<Edge>*            fEdges = nullptr;
+    int                                 fWidth = 0, fColumns = 0;
+    int                                 fFirstBand = 0, fTop = 0, fBottom = 0;
+    std::vector<Band>                   fBands;
+    std::vector<Tile>                   fTiles;
+    std::vector<std::vector<Crossing>>  fCrossings;     // per thread
+
+    // Same x the serial scan reaches on row y, computed directly rather than stepped to.
+    static int round_x_at(const Edge& edge, int y) {
+        return fixed_round_to_int(edge.x + (GFixed)((int64_t)(y - edge.y0) * edge.dx));
+    }
+
+    int bandTop(int b) const { return std::max(fTop, (b + fFirstBand) << kTileShift); }
+    int bandBottom(int b) const { return std::min(fBottom, (b + fFirstBand + 1) << kTileShift); }
+
+    void binBand(int b) {
+        Band& band = fBands[b];
+        const int stride = fColumns + 1;
+        const int top = this->bandTop(b);
+        const int bottom = this->bandBottom(b);
+
+        band.backdrop.assign(kTileSize * stride, 0);
+        band.tileEdges.resize(fColumns);
+        for (std::vector<int>& list : band.tileEdges) {
+            list.clear();
+        }
+        band.tileIsUsed.assign(fColumns, false);
+
+        for (int i : band.edges) {
+            const Edge& edge = (*fEdges)[i];
+            for (int y = std::max(edge.y0, top); y < std::min(edge.y1, bottom); ++y) {
+                const int x = round_x_at(edge, y);
+
+                // every pixel >= x is past this edge, i.e. all of the tiles starting at or after x
+                const int firstColumn = x <= 0 ? 0 : std::min(fColumns, (x + kTileSize - 1) >> kTileShift);
+                band.backdrop[(y - top) * stride + firstColumn] += edge.wind;
+
+                // x inside a tile (not on its left side) means the tile has to sort the edge
+                if (x > 0 && x < fWidth && (x & (kTileSize - 1)) != 0) {
+                    std::vector<int>& list = band.tileEdges[x >> kTileShift];
+                    if (list.empty() || list.back() != i) {
+                        list.push_back(i);
+                    }
+                }
+            }
+        }
+
+        // winding deltas -> winding at each tile's left side
+        for (int y = 0; y < bottom - top; ++y) {
+            int* row = &band.backdrop[y * stride];
+            for (int col = 1; col < stride; ++col) {
+                row[col] += row[col - 1];
+            }
+            for (int col = 0; col < fColumns; ++col) {
+                if (row[col] != 0) {
+                    band.tileIsUsed[col] = true;
+                }
+            }
+        }
+        for (int col = 0; col < fColumns; ++col) {
+            if (!band.tileEdges[col].empty()) {
+                band.tileIsUsed[col] = true;
+            }
+        }
+    }
+
+    void scanTile(int b, int col, Blitter& blitter, std::vector<Crossing>& crossings) {
+        const Band& band = fBands[b];
+        const int stride = fColumns + 1;
+        const int top = this->bandTop(b);
+        const int bottom = this->bandBottom(b);
+        const int tileLeft = col << kTileShift;
+        const int tileRight = std::min(fWidth, tileLeft + kTileSize);
+
+        for (int y = top; y < bottom; ++y) {
+            crossings.clear();
+            for (int i : band.tileEdges[col]) {
+                const Edge& edge = (*fEdges)[i];
+                if (isValidEdge(edge, y)) {
+                    const int x = round_x_at(edge, y);
+                    if (x > tileLeft && x < tileLeft + kTileSize) {
+                        crossings.push_back({x, edge.wind});
+                    }
+                }
+            }
+            std::sort(crossings.begin(), crossings.end(), [](const Crossing& a, const Crossing& b) {
+                return a.x < b.x;
+            });
+
+            int w = band.backdrop[(y - top) * stride + col];
+            int left = tileLeft;
+
+            for (const Crossing& crossing : crossings) {
+                if (w == 0) {
+                    left = crossing.x;
+                }
+                w += crossing.wind;
+                if (w == 0) {
+                    blitter.blitRow(y, left, crossing.x);
+                }
+            }
+
+            if (w != 0) {
+                blitter.blitRow(y, left, tileRight);
+            }
+        }
+    }
+};
+
+#endif
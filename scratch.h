@@ -0,0 +1,127 @@
+/*
+ *  Copyright 2024 Tyler Roth
+ */
+
+#ifndef _g_scratch_h_
+#define _g_scratch_h_
+
+#include "include/GBitmap.h"
+#include "include/GPixel.h"
+#include "include/GPoint.h"
+#include "GEdge.h"
+#include "span_list.h"
+#include <vector>
+
+/**
+ *  Working memory the canvas keeps between draws, so that drawing does not have to go to
+ *  the heap once the buffers have grown to fit the scene. Each accessor hands back its
+ *  buffer emptied (but with its old capacity). debugAllocationCount() (debug_alloc.h)
+ *  shows whether a draw still allocated.
+ */
+class Scratch {
+public:
+    Scratch(const GBitmap& device) {
+        fRow.resize(device.width());
+        fCoverage.resize(device.width());
+        fEdges.reserve(64);
+        fCurves.reserve(64);
+        fActive.reserve(64);
+        fPoints.reserve(64);
+        fMask.reset(device.width(), device.height());
+        fClippedMask.reset(device.width(), device.height());
+    }
+
+    // Room for one device row of shaded pixels.
+    GPixel* row() { return fRow.data(); }
+
+    // One device row of anti-aliasing coverage. Always all zeros between draws.
+    uint8_t* coverage() { return fCoverage.data(); }
+
+    // count floats for CoverageAccumulator. Always all zeros between draws.
+    float* accumulation(int count) {
+        if ((size_t)count > fAccumulation.size()) {
+            fAccumulation.resize(count);
+        }
+        return fAccumulation.data();
+    }
+
+    std::vector<Edge>& edges() {
+        fEdges.clear();
+        return fEdges;
+    }
+
+    // state for the curve edges in edges() (see pathBuildEdges)
+    std::vector<CurveEdge>& curves() {
+        fCurves.clear();
+        return fCurves;
+    }
+
+    // working memory for sortEdgesByRow()
+    std::vector<int>& rowStarts() {
+        return fRowStarts;
+    }
+    std::vector<Edge>& edgeCopy() {
+        return fEdgeCopy;
+    }
+
+    // edges the scanline is currently crossing
+    ActiveEdges& activeEdges() {
+        fActive.clear();
+        return fActive;
+    }
+
+    // A draw's coverage, recorded so it can be masked by the clip region, and the result.
+    SpanList& mask() {
+        fMask.clear();
+        return fMask;
+    }
+    SpanList& clippedMask() {
+        fClippedMask.clear();
+        return fClippedMask;
+    }
+
+    GPoint* points(int count) {
+        if ((size_t)count > fPoints.size()) {
+            fPoints.resize(count);
+        }
+        return fPoints.data();
+    }
+
+    // Working memory for one of the threads drawing in parallel.
+    struct Thread {
+        std::vector<GPixel> row;        // room for one device row of shaded pixels
+        std::vector<Edge>   edges;
+        ActiveEdges         activeEdges;
+    };
+
+    // Buffers for threads [0 ... count), each with its own shade row.
+    Thread* threads(int count) {
+        while ((int)fThreads.size() < count) {
+            fThreads.emplace_back();
+            fThreads.back().row.resize(fRow.size());
+        }
+        return fThreads.data();
+    }
+
+    // Room for a copy of the draw's blitter per thread (see MyCanvas::makeThreadBlitters).
+    std::vector<Blitter>& threadBlitters() {
+        fThreadBlitters.clear();
+        return fThreadBlitters;
+    }
+
+private:
+    std::vector<GPixel>  fRow;
+    std::vector<uint8_t> fCoverage;
+    std::vector<float>   fAccumulation;
+    std::vector<Edge>    fEdges;
+    std::vector<CurveEdge> fCurves;
+    std::vector<int>     fRowStarts;
+    std::vector<Edge>    fEdgeCopy;
+    ActiveEdges          fActive;
+    std::vector<GPoint>  fPoints;
+    SpanList             fMask, fClippedMask;
+    std::vector<Thread>  fThreads;
+    std::vector<Blitter> fThreadBlitters;
+};
+
+#endif
@@ -0,0 +1,186 @@
+/*
+ *  Copyright 2024 Tyler Roth
+ */
+
+#ifndef _g_span_list_h_
+#define _g_span_list_h_
+
+#include "include/GRect.h"
+#include "blitter.h"
+#include "GEdge.h"
+#include <algorithm>
+#include <string.h>
+#include <vector>
+
+/**
+ *  A mask: the coverage a scan produced, kept as runs of pixels instead of being blitted as
+ *  it is found. Each run is a row y, pixels [x0 ... x1) and the coverage they all share.
+ *
+ *  A SpanList takes the same calls a scanner (or SuperBlitter, or CoverageAccumulator) makes
+ *  on a Blitter, so any of them can record into one. blit() then plays the runs back through
+ *  a Blitter, which may use any paint, and may do so as many times as needed.
+ *
+ *  Runs are kept in row order, left to right, and never overlap, which is the order every
+ *  scanner produces them in. That lets two lists be intersected in one pass (see intersect),
+ *  so a SpanList also serves as the canvas's clip region.
+ */
+class SpanList {
+public:
+    struct Span {
+        int     y;
+        int     x0, x1;
+        uint8_t coverage;       // 0 (none) ... 255 (full)
+    };
+
+    // Forget all runs, and record for a device of this size from now on.
+    void reset(int width, int height) {
+        fSpans.clear();
+        fWidth = width;
+        fHeight = height;
+    }
+
+    // Forget all runs, keeping the device size.
+    void clear() { fSpans.clear(); }
+
+    bool isEmpty() const { return fSpans.empty(); }
+    const std::vector<Span>& spans() const { return fSpans; }
+    size_t bytesUsed() const { return fSpans.capacity() * sizeof(Span); }
+
+    // The rows a scanner may pass to blitFixedRow().
+    int height() const { return fHeight; }
+
+    // The smallest rect holding every run (empty if there are none).
+    GIRect bounds() const {
+        if (fSpans.empty()) {
+            return GIRect::WH(0, 0);
+        }
+        GIRect r = GIRect::LTRB(fWidth, fSpans.front().y, 0, fSpans.back().y + 1);
+        for (const Span& span : fSpans) {
+            r.left = std::min(r.left, span.x0);
+            r.right = std::max(r.right, span.x1);
+        }
+        return r;
+    }
+
+    /**
+     *  Replace the runs with the pixels covered by both a and b (neither of which may be this
+     *  list), with their coverages multiplied. Only the rows both lists reach are walked, so
+     *  a small draw costs about the same under a large clip region as under a small one.
+     */
+    void intersect(const SpanList& a, const SpanList& b) {
+        this->reset(a.fWidth, a.fHeight);
+        if (a.isEmpty() || b.isEmpty()) {
+            return;
+        }
+
+        const int top = std::max(a.fSpans.front().y, b.fSpans.front().y);
+        const int bottom = std::min(a.fSpans.back().y, b.fSpans.back().y) + 1;
+        size_t i = a.firstSpanOnRow(top), j = b.firstSpanOnRow(top);
+        const size_t aEnd = a.firstSpanOnRow(bottom), bEnd = b.firstSpanOnRow(bottom);
+        while (i < aEnd && j < bEnd) {
+            const Span& sa = a.fSpans[i];
+            const Span& sb = b.fSpans[j];
+            if (sa.y < sb.y || (sa.y == sb.y && sa.x1 <= sb.x0)) {
+                i++;
+            } else if (sb.y < sa.y || sb.x1 <= sa.x0) {
+                j++;
+            } else {
+                this->add(sa.y, std::max(sa.x0, sb.x0), std::min(sa.x1, sb.x1),
+                          divideBy255(sa.coverage * sb.coverage));
+                // whichever ends first can't overlap anything further along the other
+                if (sa.x1 < sb.x1) {
+                    i++;
+                } else {
+                    j++;
+                }
+            }
+        }
+    }
+
+    // Record [xLeft ... xRight) on row y as fully covered, clamped to the device.
+    void blitRow(int y, int xLeft, int xRight) {
+        this->add(y, std::max(0, xLeft), std::min(fWidth, xRight), 0xFF);
+    }
+
+    // Same as blitRow(), for a span whose ends are still in 16.16 (rounded as Blitter does).
+    void blitFixedRow(int y, GFixed xLeft, GFixed xRight) {
+        this->blitRow(y, fixed_round_to_int(xLeft), fixed_round_to_int(xRight));
+    }
+
+    // Record partial coverage for [x ... x + count) on row y, one run per stretch of equal values.
+    void blitAntiRow(int y, int x, int count, const uint8_t coverage[]) {
+        int i = 0;
+        while (i < count) {
+            const int start = i;
+            const uint8_t c = coverage[i];
+            while (i < count && coverage[i] == c) {
+                i++;
+            }
+            this->add(y, x + start, x + i, c);
+        }
+    }
+
+    // Record every pixel of the rect, which must already be inside the device.
+    void blitRect(const GIRect& r) {
+        for (int y = r.top; y < r.bottom; ++y) {
+            this->add(y, r.left, r.right, 0xFF);
+        }
+    }
+
+    /**
+     *  Draw the recorded coverage with the blitter. coverage needs room for a device row, all
+     *  zero, and is left zeroed again. Neighboring runs on a row go out as one blitAntiRow().
+     */
+    void blit(Blitter& blitter, uint8_t coverage[]) const {
+        const size_t count = fSpans.size();
+        size_t i = 0;
+        while (i < count) {
+            const Span& first = fSpans[i];
+            size_t end = i + 1;
+            while (end < count && fSpans[end].y == first.y && fSpans[end].x0 == fSpans[end - 1].x1) {
+                end++;
+            }
+
+            if (end == i + 1 && first.coverage == 0xFF) {
+                blitter.blitRow(first.y, first.x0, first.x1);
+            } else {
+                for (size_t s = i; s < end; ++s) {
+                    memset(coverage + fSpans[s].x0 - first.x0, fSpans[s].coverage,
+                           fSpans[s].x1 - fSpans[s].x0);
+                }
+                const int width = fSpans[end - 1].x1 - first.x0;
+                blitter.blitAntiRow(first.y, first.x0, width, coverage);
+                memset(coverage, 0, width);
+            }
+            i = end;
+        }
+    }
+
+private:
+    std::vector<Span>   fSpans;
+    int                 fWidth = 0, fHeight = 0;
+
+    // Index of the first run on row y or below it (binary searched, as runs are in row order).
+    size_t firstSpanOnRow(int y) const {
+        return std::lower_bound(fSpans.begin(), fSpans.end(), y, [](const Span& span, int row) {
+            return span.y < row;
+        }) - fSpans.begin();
+    }
+
+    // Skips empty and uncovered runs, and joins a run onto the one before it when they touch.
+    void add(int y, int x0, int x1, uint8_t coverage) {
+        if (x0 >= x1 || coverage == 0) {
+            return;
+        }
+        if (!fSpans.empty()) {
+            Span& last = fSpans.back();
+            if (last.y == y && last.x1 == x0 && last.coverage == coverage) {
+                last.x1 = x1;
+                return;
+            }
+        }
+        fSpans.push_back({y, x0, x1, coverage});
+    }
+};
+
+#endif
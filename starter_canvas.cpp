@@ -11,20 +11,158 @@
 #include "my_blend.h"
 #include "GEdge.h"
 #include <iostream>
+#include <type_traits>
 #include <vector>
 
-MyCanvas::MyCanvas(const GBitmap& device) : fDevice(device) {
+MyCanvas::MyCanvas(const GBitmap& device) : fDevice(device), fScratch(device) {
     fCTM = {1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f};
-    fSaveStack.push(fCTM);  
+    fClipBounds = GIRect::WH(device.width(), device.height());
+    fSaveStack.push({fCTM, fClipBounds, fClipRegion});
+}
+
+MyCanvas::~MyCanvas() {
+    this->flush();
+}
+
+void MyCanvas::setDeferredClear(bool defer) {
+    if (!defer) {
+        this->flush();
+    }
+    fDeferClears = defer;
+}
+
+void MyCanvas::flush() {
+    fDeferredClear.flush(fDevice);
+}
+
+void MyCanvas::setTiledPaths(int threadCount) {
+    fTileThreads = threadCount;
+    this->updatePool();
+}
+
+void MyCanvas::setParallelBands(int bandCount) {
+    fBandCount = bandCount;
+    this->updatePool();
+}
+
+void MyCanvas::setEdgeCache(size_t budget) {
+    fEdgeCache.reset(budget > 0 ? new EdgeCache(budget) : nullptr);
+}
+
+// One thread per band or per tiling thread, whichever is more.
+void MyCanvas::updatePool() {
+    const int threadCount = std::max(fTileThreads, fBandCount);
+    if (threadCount <= 1) {
+        fPool.reset();
+    } else if (!fPool || fPool->threadCount() != threadCount) {
+        fPool.reset(new ThreadPool(threadCount));
+    }
+}
+
+// Copies of blitter for each pool thread, each shading into that thread's own row. They
+// live in fScratch until the next draw that needs them.
+Blitter* MyCanvas::makeThreadBlitters(const Blitter& blitter) {
+    Scratch::Thread* threads = fScratch.threads(fPool->threadCount());
+    std::vector<Blitter>& blitters = fScratch.threadBlitters();
+    blitters.reserve(fPool->threadCount());
+    for (int i = 0; i < fPool->threadCount(); ++i) {
+        blitters.emplace_back(blitter, threads[i].row.data());
+    }
+    return blitters.data();
+}
+
+// The first device row of band [0 ... fBandCount]; band fBandCount starts past the bottom.
+int MyCanvas::bandTop(int band) const {
+    return (int)((int64_t)band * fDevice.height() / fBandCount);
+}
+
+// True if the edges (sorted by y0) reach into more than one of the fBandCount bands.
+bool MyCanvas::spansBands(const std::vector<Edge>& edges) {
+    int bottom = 0;
+    for (const Edge& edge : edges) {
+        bottom = std::max(bottom, edge.y1);
+    }
+    const int top = std::max(0, edges.front().y0);
+    bottom = std::min(fDevice.height(), bottom);
+    for (int band = 1; band < fBandCount; ++band) {
+        if (top < this->bandTop(band) && this->bandTop(band) < bottom) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Scans the edges (sorted by y0 then x) as fBandCount horizontal bands of the device, one
+// task per band. Each band starts from the first edge that reaches it and scans its own
+// copy of the edges, cut down to its rows, so the tasks share nothing but the pixels.
+void MyCanvas::scanBands(const std::vector<Edge>& edges, bool convex, const Blitter& blitter) {
+    const int height = fDevice.height();
+
+    size_t firstEdge = 0;
+    int drawBottom = 0;
+    for (size_t i = 0; i < edges.size(); ++i) {
+        if (edges[i].y1 <= 0 && firstEdge == i) {
+            firstEdge++;
+        }
+        drawBottom = std::max(drawBottom, edges[i].y1);
+    }
+
+    Blitter* blitters = this->makeThreadBlitters(blitter);
+    blitters[0].resolveRows(std::max(0, edges.front().y0), std::min(height, drawBottom));
+    Scratch::Thread* threads = fScratch.threads(fPool->threadCount());
+    // room for every edge on every thread, whichever bands each one ends up with
+    for (int i = 0; i < fPool->threadCount(); ++i) {
+        threads[i].edges.reserve(edges.size());
+        threads[i].activeEdges.reserve((int)edges.size());
+    }
+
+    fPool->parallelFor(fBandCount, [&](int band, int thread) {
+        const int top = this->bandTop(band);
+        const int bottom = this->bandTop(band + 1);
+
+        std::vector<Edge>& bandEdges = threads[thread].edges;
+        bandEdges.clear();
+        for (size_t i = firstEdge; i < edges.size() && edges[i].y0 < bottom; ++i) {
+            Edge edge = edges[i];
+            if (edge.y1 <= top) {
+                continue;
+            }
+            if (edge.y0 < top) {
+                // where the serial scan would have stepped x to by the band's first row
+                edge.x += (GFixed)((int64_t)(top - edge.y0) * edge.dx);
+                edge.y0 = top;
+            }
+            edge.y1 = std::min(edge.y1, bottom);
+            bandEdges.push_back(edge);
+        }
+
+        if (bandEdges.size() < 2) {
+            return;
+        }
+        if (convex) {
+            this->convexScan(bandEdges, blitters[thread]);
+        } else {
+            // the edges moved down to the band's top row come first, and need their x order
+            auto firstRowEnd = std::find_if(bandEdges.begin(), bandEdges.end(), [top](const Edge& edge) {
+                return edge.y0 > top;
+            });
+            std::sort(bandEdges.begin(), firstRowEnd, sortEdgesByX);
+
+            threads[thread].activeEdges.clear();
+            this->pathScan(bandEdges, threads[thread].activeEdges, blitters[thread]);
+        }
+    });
 }
 
 void MyCanvas::save() {
-    fSaveStack.push(fCTM);
+    fSaveStack.push({fCTM, fClipBounds, fClipRegion});
 };
 
 void MyCanvas::restore() {
     assert(!fSaveStack.empty());
-    fCTM = fSaveStack.top();
+    fCTM = fSaveStack.top().ctm;
+    fClipBounds = fSaveStack.top().clipBounds;
+    fClipRegion = fSaveStack.top().clipRegion;
     fSaveStack.pop();
 };
 
@@ -34,20 +172,110 @@ void MyCanvas::concat(const GMatrix& matrix) {
 
 
 void MyCanvas::clear(const GColor& color) {
-    GPixel *row_address;
-    int height = fDevice.height();
-    int width = fDevice.width();
     GPixel newColor = color_to_pixel(color);
 
-    for (int y=0; y<height; y++) {
-        row_address = fDevice.getAddr(0, y);
-        for (int x=0; x<width; x++) {
-            row_address[x] = newColor;
-        }
+    if (fDeferClears) {
+        fDeferredClear.record(fDevice, newColor);
+    } else {
+        fDeferredClear.discard();
+        clear_bitmap(fDevice, newColor);
+    }
+}
+
+// The device-space box around a local-space rect.
+static GRect map_bounds(const GMatrix& m, const GRect& r) {
+    GPoint corners[4] = {{r.left, r.top}, {r.right, r.top}, {r.right, r.bottom}, {r.left, r.bottom}};
+    m.mapPoints(corners, 4);
+
+    GRect bounds = GRect::LTRB(corners[0].x, corners[0].y, corners[0].x, corners[0].y);
+    for (int i = 1; i < 4; ++i) {
+        bounds = GRect::LTRB(std::min(bounds.left, corners[i].x), std::min(bounds.top, corners[i].y),
+                             std::max(bounds.right, corners[i].x), std::max(bounds.bottom, corners[i].y));
+    }
+    return bounds;
+}
+
+// True if nothing inside the (device-space) bounds can touch a pixel of area.
+static bool misses_area(const GRect& bounds, const GIRect& area) {
+    return area.isEmpty() || bounds.right <= area.left || bounds.bottom <= area.top ||
+           bounds.left >= area.right || bounds.top >= area.bottom;
+}
+
+static GIRect intersect_rects(const GIRect& a, const GIRect& b) {
+    return GIRect::LTRB(std::max(a.left, b.left), std::max(a.top, b.top),
+                        std::min(a.right, b.right), std::min(a.bottom, b.bottom));
+}
+
+// True if the matrix maps axis-aligned rects to axis-aligned rects (scale/translate, maybe
+// with a 90 degree turn).
+static bool preserves_rects(const GMatrix& m) {
+    return (m[1] == 0 && m[2] == 0) || (m[0] == 0 && m[3] == 0);
+}
+
+// The pixels an aliased draw of rect covers, when fCTM preserves rects.
+static GIRect rect_device_area(const GMatrix& ctm, const GRect& rect, const GBitmap& device) {
+    GPoint corners[2] = {{rect.left, rect.top}, {rect.right, rect.bottom}};
+    ctm.mapPoints(corners, 2);
+
+    // pin before rounding so huge rects can't overflow the ints
+    float width = static_cast<float>(device.width());
+    float height = static_cast<float>(device.height());
+    GRect devRect = GRect::LTRB(
+        std::max(0.0f, std::min(corners[0].x, corners[1].x)),
+        std::max(0.0f, std::min(corners[0].y, corners[1].y)),
+        std::min(width, std::max(corners[0].x, corners[1].x)),
+        std::min(height, std::max(corners[0].y, corners[1].y)));
+
+    // rounding keeps the pixels whose centers are > min edge and <= max edge
+    return devRect.round();
+}
+
+void MyCanvas::clipRect(const GRect& rect) {
+    // a rect that stays a rect on the device only narrows the clip's bounds
+    if (preserves_rects(fCTM)) {
+        fClipBounds = intersect_rects(fClipBounds, rect_device_area(fCTM, rect, fDevice));
+        return;
+    }
+
+    GPathBuilder builder;
+    builder.addRect(rect);
+    this->clipPath(*builder.detach(), false);
+}
+
+void MyCanvas::clipPath(const GPath& path, bool antiAlias) {
+    if (!antiAlias && path.shape() == GPath::Shape::kRect && preserves_rects(fCTM)) {
+        this->clipRect(path.bounds());
+        return;
     }
+
+    // the path's coverage, as a draw would record it, is the new region
+    auto region = std::make_shared<SpanList>();
+    this->recordPath(path, antiAlias, *region);
+    if (fClipRegion) {
+        auto both = std::make_shared<SpanList>();
+        both->intersect(*region, *fClipRegion);
+        region = std::move(both);
+    }
+
+    fClipBounds = intersect_rects(fClipBounds, region->bounds());
+    fClipRegion = std::move(region);
 }
 
 void MyCanvas::drawRect(const GRect& rect, const GPaint& paint) {
+    // anti-aliased rects go through the polygon path to get their partial edge pixels
+    if (preserves_rects(fCTM) && !paint.isAntiAlias()) {
+        const GIRect area = intersect_rects(rect_device_area(fCTM, rect, fDevice), fClipBounds);
+        if (area.isEmpty()) {
+            return;
+        }
+
+        Blitter blitter = this->makeBlitter(paint);
+        if (!blitter.isNoop()) {
+            this->fillClipped(blitter, [&](auto& sink) { sink.blitRect(area); });
+        }
+        return;
+    }
+
     GPoint points[4] = {
         {rect.right, rect.top},
         {rect.right, rect.bottom},
@@ -64,174 +292,379 @@ void MyCanvas::drawConvexPolygon(const GPoint points[], int count, const GPaint&
         return;
     }
 
-    // put points back
-    std::vector<Edge> edges;
-
-    GShader* shader = paint.peekShader();
-
-    if (shader) {
-        shader->setContext(fCTM);
+    Blitter blitter = this->makeBlitter(paint);
+    if (blitter.isNoop()) {
+        return;
     }
-    
-    GPoint dstPoints[count];
-    fCTM.mapPoints(dstPoints, points, count);
 
-    edges = buildEdges(fDevice, count, dstPoints);
+    const bool antiAlias = paint.isAntiAlias();
+    if (std::vector<Edge>* edges = this->polygonEdges(points, count, antiAlias, fClipBounds)) {
+        this->fillClipped(blitter, [&](auto& sink) {
+            this->scanConvexEdges(*edges, antiAlias, sink);
+        });
+    }
+}
 
-    if (edges.size() < 2) {
+void MyCanvas::recordConvexPolygon(const GPoint points[], int count, bool antiAlias, SpanList& mask) {
+    mask.reset(fDevice.width(), fDevice.height());
+    if (count < 3) {
         return;
     }
 
-    std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) {
-        // case if tops are the same
-        if (a.y0 == b.y0) {
-            return a.x0 < b.x0;
-        }
-        return a.y0 < b.y0;
-    });
-
-    // std::sort(edges.begin(), edges.end(), sortEdges);
+    const GIRect device = GIRect::WH(fDevice.width(), fDevice.height());
+    if (std::vector<Edge>* edges = this->polygonEdges(points, count, antiAlias, device)) {
+        this->scanConvexEdges(*edges, antiAlias, mask);
+    }
+}
 
-    if (edges.empty()) {
+void MyCanvas::drawMask(const SpanList& mask, const GPaint& paint) {
+    Blitter blitter = this->makeBlitter(paint);
+    if (blitter.isNoop()) {
         return;
     }
 
-    for (int y = std::max(0, edges.front().y0); y < std::min(fDevice.height(), edges.back().y1); ++y) {
-        std::vector<float> xIntersections;
-        int fy = GRoundToInt(y + 0.5f);
-        for (const Edge& edge : edges) {
-            if (y >= edge.y0 && y < edge.y1) {
-                // float x = edge.start.x + (fy - edge.start.y) * edge.m;
-                float x = edge.computeX(fy);
-                xIntersections.push_back(x);
-            }
-        }
+    if (fClipRegion) {
+        SpanList& clipped = fScratch.clippedMask();
+        clipped.intersect(mask, *fClipRegion);
+        clipped.blit(blitter, fScratch.coverage());
+    } else {
+        mask.blit(blitter, fScratch.coverage());
+    }
+}
 
-        std::sort(xIntersections.begin(), xIntersections.end());
+/**
+ *  The polygon's edges under fCTM, with y scaled by SuperBlitter::kScale when anti-aliasing,
+ *  or nullptr if the polygon misses area, in which case no edges are built at all.
+ */
+std::vector<Edge>* MyCanvas::polygonEdges(const GPoint points[], int count, bool antiAlias,
+                                          const GIRect& area) {
+    GPoint* dstPoints = fScratch.points(count);
+    fCTM.mapPoints(dstPoints, points, count);
 
-        for (size_t i = 0; i < xIntersections.size(); i += 2) {
-            int x1 = pin(GRoundToInt(xIntersections[i]), fDevice.width());
-            int x2 = pin(GRoundToInt((xIntersections[i + 1])), fDevice.width());
+    GRect bounds = GRect::LTRB(dstPoints[0].x, dstPoints[0].y, dstPoints[0].x, dstPoints[0].y);
+    for (int i = 1; i < count; ++i) {
+        bounds = GRect::LTRB(std::min(bounds.left, dstPoints[i].x), std::min(bounds.top, dstPoints[i].y),
+                             std::max(bounds.right, dstPoints[i].x), std::max(bounds.bottom, dstPoints[i].y));
+    }
+    if (misses_area(bounds, area)) {
+        return nullptr;
+    }
 
-            blit(y, x1, x2, paint);
+    // scaling by a power of two is exact, so this matches mapping by Scale(1, kScale) * fCTM
+    const int superScale = antiAlias ? SuperBlitter<>::kScale : 1;
+    if (antiAlias) {
+        for (int i = 0; i < count; ++i) {
+            dstPoints[i].y *= superScale;
         }
     }
-}
 
-void MyCanvas::blit(int y, int xLeft, int xRight, const GPaint& paint) {
-    xLeft = std::max(0, xLeft);
-    xRight = std::min(fDevice.width(), xRight);
+    std::vector<Edge>& edges = fScratch.edges();
+    buildEdges(fDevice.width(), fDevice.height() * superScale, count, dstPoints, edges);
+    return &edges;
+}
 
-    GBlendMode blendMode = paint.getBlendMode();
+/**
+ *  Hands fill (a callable taking any SpanBlitter) the blitter to draw into, unless the clip is
+ *  a region: then the draw is recorded, masked by the region and blitted from that.
+ */
+template <typename Fill> void MyCanvas::fillClipped(Blitter& blitter, Fill fill) {
+    if (!fClipRegion) {
+        fill(blitter);
+        return;
+    }
 
-    GShader* shader = paint.peekShader();
-    if (shader == nullptr) {
-        GColor color = paint.getColor().pinToUnit();
-        GPixel srcPixel = color_to_pixel(color);
+    SpanList& mask = fScratch.mask();
+    fill(mask);
+    SpanList& clipped = fScratch.clippedMask();
+    clipped.intersect(mask, *fClipRegion);
+    clipped.blit(blitter, fScratch.coverage());
+}
 
-        for (int x = xLeft; x < xRight; ++x) {
-            GPixel* addr = fDevice.getAddr(x, y);
+// A blitter for paint, limited to the clip's bounds.
+Blitter MyCanvas::makeBlitter(const GPaint& paint) {
+    Blitter blitter(fDevice, paint, fCTM, fScratch.row(), &fDeferredClear);
+    blitter.setClip(fClipBounds);
+    return blitter;
+}
 
-            GPixel blendedPixel = blendColors(srcPixel, *addr, blendMode);
-            
-            *addr = blendedPixel;
-        }
-    } else {
-        if (!shader->setContext(fCTM)) {
-            return;
-        }
+// Fills the (unsorted) edges of a convex shape, built with y scaled by SuperBlitter::kScale
+// when anti-aliasing. Only spans bound for the device (a Blitter) may be split into bands.
+template <typename SpanBlitter>
+void MyCanvas::scanConvexEdges(std::vector<Edge>& edges, bool antiAlias, SpanBlitter& blitter) {
+    if (edges.size() < 2) {
+        return;
+    }
 
-        if (xRight < xLeft) {
-            std::swap(xRight, xLeft);
-        }
+    sortEdgesByRow(edges, fScratch.rowStarts(), fScratch.edgeCopy());
 
-        assert(xLeft <= xRight);
-        int count = xRight - xLeft;
-        // GPixel shaded[count];
-        if (count <= 0) {
+    if constexpr (std::is_same<SpanBlitter, Blitter>::value) {
+        if (fBandCount > 1 && !antiAlias && blitter.isThreadSafe() && this->spansBands(edges)) {
+            this->scanBands(edges, true, blitter);
             return;
         }
-        std::vector<GPixel> shaded(count);
+    }
 
-        shader->shadeRow(xLeft, y, count, shaded.data());
+    if (antiAlias) {
+        SuperBlitter superBlitter(blitter, fDevice.width(), fDevice.height(), fScratch.coverage());
+        convexScan(edges, superBlitter);
+    } else {
+        convexScan(edges, blitter);
+    }
+}
 
-        if (shader->isOpaque()) {
-            for (int x = xLeft; x < xRight; ++x) {
-                GPixel* addr = fDevice.getAddr(x, y);
-                GPixel srcPixel = shaded[x - xLeft];
+// Scan converts the (clipped) edges of a convex polygon, sorted by y0 then x.
+//
+// Every row of a convex polygon crosses exactly two edges, so rather than testing every edge
+// on every row, walk two of them down the polygon: when one runs out, the next edge in y
+// order is the one that continues that side.
+template <typename SpanBlitter>
+void MyCanvas::convexScan(std::vector<Edge>& edges, SpanBlitter& blitter) {
+    Edge* e0 = &edges[0];
+    Edge* e1 = &edges[1];
+    size_t next = 2;
+
+    for (int y = std::max(0, edges.front().y0); y < std::min(blitter.height(), edges.back().y1); ++y) {
+        while (y >= e0->y1 && next < edges.size()) {
+            e0 = &edges[next++];
+        }
+        while (y >= e1->y1 && next < edges.size()) {
+            e1 = &edges[next++];
+        }
 
-                *addr = srcPixel;
-            }
-        } else {
-            for (int x = xLeft; x < xRight; ++x) {
-                GPixel* addr = fDevice.getAddr(x, y);
-                GPixel srcPixel = shaded[x - xLeft];
+        if (!isValidEdge(*e0, y) || !isValidEdge(*e1, y)) {
+            continue;
+        }
 
-                GPixel blendedPixel = blendColors(srcPixel, *addr, blendMode);
+        blitter.blitFixedRow(y, std::min(e0->x, e1->x), std::max(e0->x, e1->x));
 
-                *addr = blendedPixel;
-            }
-        }
+        e0->x += e0->dx;
+        e1->x += e1->dx;
     }
 }
 
-// check edges for consistency in sorting both by x and y. could also use exit after both sorts to check
-void MyCanvas::pathScan(std::vector<Edge> edges, GShader* shader, GPaint paint, GPixel src) {
+// Scan converts edges that are sorted by y0 (then x), using nonzero winding.
+//
+// Edges join the active list when the scanline reaches their top, merged in by x, and drop out
+// (keeping the order of the rest) on their last row. The active list stays sorted by x; since
+// x only moves a little from one row to the next, an insertion sort restores the order in
+// about one pass.
+template <typename SpanBlitter>
+void MyCanvas::pathScan(std::vector<Edge>& edges, ActiveEdges& active, SpanBlitter& blitter,
+                        CurveEdge curves[]) {
+    size_t next = 0;
     int top = edges.front().y0;
-    int left, right;
+    GFixed left = 0;
+
+    while (next < edges.size() || active.size() > 0) {
+        if (active.size() == 0) {
+            top = std::max(top, edges[next].y0);    // skip rows with nothing on them
+        }
+
+        // steps and new curve segments leave the list nearly sorted; new edges come sorted
+        active.sortByX();
+
+        const size_t first = next;
+        while (next < edges.size() && edges[next].y0 <= top) {
+            next++;
+        }
+        active.merge(edges, (int)first, (int)next);
 
-    while (edges.size() > 0) {
-        int i = 0;
+        const int count = active.size();
         int w = 0;
 
-        while (i < edges.size() && isValidEdge(edges[i], top)) {
+        for (int i = 0; i < count; ++i) {
             if (w == 0) {
-                left = GRoundToInt(edges[i].x0);
+                left = active.x[i];
             }
 
-            assert(edges[i].wind == 1 || edges[i].wind == -1);
+            assert(active.wind[i] == 1 || active.wind[i] == -1);
 
-            w += edges[i].wind;
+            w += active.wind[i];
 
             if (w == 0) {
-                right = GRoundToInt(edges[i].x0);
-                blit(top, left, right, paint);
-            }
-
-            if (!isValidEdge(edges[i], top + 1)) {
-                edges.erase(edges.begin() + i);
-            } else {
-                edges[i].x0 += edges[i].m;
-                i++;
+                blitter.blitFixedRow(top, left, active.x[i]);
             }
         }
 
         assert(w == 0);
-        top++;
 
-        while (i < edges.size() && isValidEdge(edges[i], top)) {
-            i++;
+        active.step();
+
+        // drop the edges that end on this row, unless they are curves with more segments
+        int kept = 0;
+        for (int i = 0; i < count; ++i) {
+            if (active.y1[i] > top + 1) {
+                active.move(i, kept++);
+                continue;
+            }
+
+            Edge& edge = edges[active.edge[i]];
+            if (edge.curve >= 0 && curves[edge.curve].nextSegment(edge)) {
+                // the curve's next segment picks up on the next row
+                assert(edge.y0 == top + 1);
+                active.set(kept++, edge, active.edge[i]);
+            }
         }
 
-        std::sort(edges.begin(), edges.begin() + i, sortEdgesByX);
+        active.resize(kept);
+        top++;
     }
 }
 
+// Paths covering fewer pixels than this are scanned on one thread even when tiling is on.
+static const int kMinTiledPathArea = 4 * PathTiler::kTileSize * PathTiler::kTileSize;
+
+// True if everything inside the (device-space) bounds is on the device, so nothing is clipped.
+static bool is_inside_device(const GRect& bounds, const GBitmap& device) {
+    return bounds.left >= 0 && bounds.top >= 0 &&
+           bounds.right <= device.width() && bounds.bottom <= device.height();
+}
+
+// The device pixels that anything inside the (device-space) bounds can touch.
+static GIRect device_area(const GRect& bounds, const GBitmap& device) {
+    // pin before rounding so huge paths can't overflow the ints
+    float width = static_cast<float>(device.width());
+    float height = static_cast<float>(device.height());
+    return GRect::LTRB(std::max(0.0f, bounds.left), std::max(0.0f, bounds.top),
+                       std::min(width, bounds.right), std::min(height, bounds.bottom)).roundOut();
+}
+
 void MyCanvas::drawPath(const GPath& path, const GPaint& paint) {
-    std::shared_ptr<GPath> copy = path.transform(fCTM);
+    // the path's bounds are cached, so a draw that misses the clip costs four mapped points
+    const GRect bounds = map_bounds(fCTM, path.bounds());
+    if (misses_area(bounds, fClipBounds)) {
+        return;
+    }
+
+    Blitter blitter = this->makeBlitter(paint);
+    if (blitter.isNoop()) {
+        return;
+    }
+
+    this->fillClipped(blitter, [&](auto& sink) {
+        this->scanPath(path, bounds, paint.isAntiAlias(), sink);
+    });
+}
+
+void MyCanvas::recordPath(const GPath& path, bool antiAlias, SpanList& mask) {
+    mask.reset(fDevice.width(), fDevice.height());
+
+    const GRect bounds = map_bounds(fCTM, path.bounds());
+    if (!misses_area(bounds, GIRect::WH(fDevice.width(), fDevice.height()))) {
+        this->scanPath(path, bounds, antiAlias, mask);
+    }
+}
+
+// Fills the path (its device bounds already known to touch the device) into blitter. Spans
+// bound for the device (a Blitter) may be drawn by several threads; a SpanList is filled on
+// this one.
+template <typename SpanBlitter>
+void MyCanvas::scanPath(const GPath& path, const GRect& bounds, bool antiAlias, SpanBlitter& blitter) {
+    // Without anti-aliasing, a rect needs no edges at all and a convex contour needs no
+    // winding. (Anti-aliased paths keep their own coverage, see below.)
+    const GPath::Shape shape = antiAlias ? GPath::Shape::kGeneral : path.shape();
+    if (shape == GPath::Shape::kRect && preserves_rects(fCTM)) {
+        GIRect area = rect_device_area(fCTM, path.bounds(), fDevice);
+        if (!area.isEmpty()) {
+            blitter.blitRect(area);
+        }
+        return;
+    }
+
+    if (shape != GPath::Shape::kGeneral) {
+        // the same edges the general scan would get
+        std::vector<Edge>& edges = fScratch.edges();
+        pathBuildEdges(path, fCTM, fDevice.width(), fDevice.height(), edges);
+        this->scanConvexEdges(edges, false, blitter);
+        return;
+    }
+
+    // edges are built straight from the path's points, mapped as they are read
+    GMatrix ctm = fCTM;
+
+    // anti-aliasing scans SuperBlitter::kScale sub-rows per row
+    const int superScale = antiAlias ? SuperBlitter<>::kScale : 1;
+
+    if (antiAlias) {
+        GIRect area = device_area(bounds, fDevice);
+        if (area.isEmpty()) {
+            return;
+        }
+
+        // small paths get exact coverage from the accumulator instead
+        if (area.width() * area.height() <= CoverageAccumulator::kMaxArea) {
+            CoverageAccumulator accumulator(area,
+                    fScratch.accumulation(CoverageAccumulator::StorageSize(area)));
+            flattenPath(path, ctm, [&](GPoint p0, GPoint p1) {
+                accumulator.addLine(p0, p1);
+            });
+            accumulator.blit(blitter, fScratch.coverage());
+            return;
+        }
+
+        ctm = GMatrix::Scale(1, superScale) * fCTM;
+    }
+
+    constexpr bool toDevice = std::is_same<SpanBlitter, Blitter>::value;
+    bool parallel = false;
+    if constexpr (toDevice) {
+        parallel = !antiAlias && blitter.isThreadSafe();
+    }
 
-    std::vector<Edge> edges = pathBuildEdges(copy, fDevice.width(), fDevice.height());
+    // tiles don't need the edges sorted; smaller paths aren't worth waking the pool for
+    bool tiled = false;
+    if (fTileThreads > 1 && parallel) {
+        GIRect area = device_area(bounds, fDevice);
+        tiled = area.width() * area.height() >= kMinTiledPathArea;
+    }
+
+    // the parallel scanners need every edge up front, so only the serial scan gets curve edges
+    const bool serial = !tiled && !(fBandCount > 1 && parallel);
+    std::vector<CurveEdge>& curves = fScratch.curves();
+    std::vector<Edge>& edges = fScratch.edges();
+    const int rows = fDevice.height() * superScale;
+
+    if (fEdgeCache) {
+        // cached edges are sorted lines, which every scanner can take
+        const bool unclipped = is_inside_device(bounds, fDevice);
+        if (!fEdgeCache->find(path, ctm, rows, unclipped, edges)) {
+            pathBuildEdges(path, ctm, fDevice.width(), rows, edges);
+            sortEdgesByRow(edges, fScratch.rowStarts(), fScratch.edgeCopy());
+            fEdgeCache->add(path, ctm, rows, unclipped, edges);
+        }
+    } else {
+        pathBuildEdges(path, ctm, fDevice.width(), rows, edges, serial ? &curves : nullptr);
+    }
 
     if (edges.size() < 2) {
         return;
     }
 
-    std::sort(edges.begin(), edges.end(), sortEdges);
+    if constexpr (toDevice) {
+        if (tiled) {
+            fTiler.scan(edges, fDevice.width(), fDevice.height(),
+                        this->makeThreadBlitters(blitter), *fPool);
+            return;
+        }
+    }
+
+    if (!fEdgeCache) {
+        sortEdgesByRow(edges, fScratch.rowStarts(), fScratch.edgeCopy());
+    }
 
-    GPixel src = color_to_pixel(paint.getColor());
-    GShader* shader = paint.peekShader();
+    if constexpr (toDevice) {
+        if (!serial && this->spansBands(edges)) {
+            this->scanBands(edges, false, blitter);
+            return;
+        }
+    }
 
-    pathScan(edges, shader, paint, src);
+    if (antiAlias) {
+        SuperBlitter superBlitter(blitter, fDevice.width(), fDevice.height(), fScratch.coverage());
+        pathScan(edges, fScratch.activeEdges(), superBlitter, curves.data());
+    } else {
+        pathScan(edges, fScratch.activeEdges(), blitter, curves.data());
+    }
 }
 
 void MyCanvas::drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[], int count, const int indices[], const GPaint& paint) {
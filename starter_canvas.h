@@ -15,6 +15,15 @@
 #include "decorator_shader.h"
 #include "joined_shader.h"
 #include "my_utils.h"
+#include "blitter.h"
+#include "scratch.h"
+#include "super_blitter.h"
+#include "accumulator.h"
+#include "path_tiler.h"
+#include "thread_pool.h"
+#include "edge_cache.h"
+#include "span_list.h"
+#include <memory>
 #include "stdlib.h"
 #include <stack>
 
@@ -22,6 +31,53 @@ class MyCanvas : public GCanvas {
 public:
     // MyCanvas(const GBitmap& device) : fDevice(device) {}
     MyCanvas(const GBitmap& device);
+    ~MyCanvas() override;
+
+    /**
+     *  When enabled, clear() only records its color. Each row is cleared by the first draw
+     *  that touches it, and the rest are written by flush() (or when the canvas goes away).
+     *  Call flush() before reading the pixels while a clear may still be pending.
+     */
+    void setDeferredClear(bool defer);
+    void flush();
+
+    /**
+     *  With more than one thread, large aliased paths drawn with a color (no shader) are
+     *  scanned as tiles spread over a pool of that many threads. The pixels are the same as
+     *  drawing them on one thread.
+     */
+    void setTiledPaths(int threadCount);
+
+    /**
+     *  With more than one band, the device is split into that many horizontal bands and each
+     *  aliased polygon or path is scanned one band per thread. Shaded paints qualify when
+     *  their shader is thread safe (GShader::isThreadSafe); each thread shades into its own
+     *  row. The pixels are the same as drawing on one thread.
+     */
+    void setParallelBands(int bandCount);
+
+    /**
+     *  With a budget (in bytes), the edges built for each path are kept in an EdgeCache and
+     *  reused when the path is drawn again under the same matrix or a whole-pixel
+     *  translation of it. A budget of 0 (the default) turns the cache off. Rects and convex
+     *  paths drawn without anti-aliasing don't use it (see GPath::shape).
+     */
+    void setEdgeCache(size_t budget);
+
+    // The edge cache (for its counters), or nullptr while it is off.
+    const EdgeCache* edgeCache() const { return fEdgeCache.get(); }
+
+    /**
+     *  Intersect the clip with the rect or path under the current matrix. save() and restore()
+     *  keep the clip along with the matrix, and clear() ignores it.
+     *
+     *  A rect that stays a rect on the device just narrows the clip's bounds, which the
+     *  blitter trims every span to. Anything else becomes a run-length region (a SpanList,
+     *  with partial coverage along its edges when anti-aliased): draws are then recorded and
+     *  masked by it. Either way, a draw whose bounds miss the clip builds no edges.
+     */
+    void clipRect(const GRect&);
+    void clipPath(const GPath&, bool antiAlias);
 
     void save() override;
     void restore() override;
@@ -30,9 +86,28 @@ public:
     void fillRect(const GRect& rect, const GColor& color);
     void drawRect(const GRect&, const GPaint&) override;
     void drawConvexPolygon(const GPoint[], int count, const GPaint& paint) override;
-    void blit(const int y, const int xLeft, const int xRight, const GPaint& paint);
-    void pathScan(std::vector<Edge> edges, GShader* shader, GPaint paint, GPixel src);
+
+    /**
+     *  The scanners feed a Blitter, a SpanList or, for anti-aliased paints, a SuperBlitter
+     *  in front of either.
+     *  pathScan also steps curve edges, given the curves they point into (see pathBuildEdges).
+     */
+    template <typename SpanBlitter> void convexScan(std::vector<Edge>& edges, SpanBlitter& blitter);
+    template <typename SpanBlitter> void pathScan(std::vector<Edge>& edges, ActiveEdges& active,
+                                                  SpanBlitter& blitter, CurveEdge curves[] = nullptr);
+
     void drawPath(const GPath&, const GPaint&);
+
+    /**
+     *  Record the coverage drawPath() / drawConvexPolygon() would produce under the current
+     *  matrix (anti-aliased or not, ignoring the clip) into mask, instead of drawing it.
+     *  drawMask() then draws it through the clip, with any paint, as many times as needed;
+     *  the mask is in device pixels, so the matrix at that point only affects the paint's
+     *  shader.
+     */
+    void recordPath(const GPath&, bool antiAlias, SpanList& mask);
+    void recordConvexPolygon(const GPoint[], int count, bool antiAlias, SpanList& mask);
+    void drawMask(const SpanList& mask, const GPaint&);
     void drawMesh(const GPoint verts[], const GColor colors[], const GPoint texs[], int count, const int indices[], const GPaint&);
     void drawQuad(const GPoint verts[4], const GColor colors[4], const GPoint texs[4], int level, const GPaint&);
 
@@ -40,7 +115,40 @@ private:
     // Note: we store a copy of the bitmap
     const GBitmap fDevice;
     GMatrix fCTM;
-    std::stack<GMatrix> fSaveStack;
+    // the state save() keeps and restore() puts back
+    struct SavedState {
+        GMatrix                         ctm;
+        GIRect                          clipBounds;
+        std::shared_ptr<const SpanList> clipRegion;
+    };
+    std::stack<SavedState> fSaveStack;
+
+    // Pixels outside fClipBounds are never drawn. If there is a region, only the pixels it
+    // covers are, scaled by its coverage.
+    GIRect fClipBounds;
+    std::shared_ptr<const SpanList> fClipRegion;
+    DeferredClear fDeferredClear;
+    bool fDeferClears = false;
+    Scratch fScratch;
+    std::unique_ptr<ThreadPool> fPool;
+    int fTileThreads = 1;
+    int fBandCount = 1;
+    PathTiler fTiler;
+    std::unique_ptr<EdgeCache> fEdgeCache;
+
+    Blitter makeBlitter(const GPaint& paint);
+    template <typename Fill> void fillClipped(Blitter& blitter, Fill fill);
+    std::vector<Edge>* polygonEdges(const GPoint points[], int count, bool antiAlias,
+                                    const GIRect& area);
+    template <typename SpanBlitter> void scanConvexEdges(std::vector<Edge>& edges, bool antiAlias,
+                                                         SpanBlitter& blitter);
+    template <typename SpanBlitter> void scanPath(const GPath& path, const GRect& bounds,
+                                                  bool antiAlias, SpanBlitter& blitter);
+    void updatePool();
+    Blitter* makeThreadBlitters(const Blitter& blitter);
+    int bandTop(int band) const;
+    bool spansBands(const std::vector<Edge>& edges);
+    void scanBands(const std::vector<Edge>& edges, bool convex, const Blitter& blitter);
 
     // Add whatever other fields you need
 
@@ -11,6 +11,7 @@
 #include "starter_path.h"
 #include <iostream>
 #include <initializer_list> 
+#include <atomic>
 
 #define dT_constant 0.5519150244935105707435627f;
 
@@ -54,142 +55,174 @@ void GPathBuilder::addPolygon(const GPoint pts[], int count) {
     }
 }
 
-GRect GPath::bounds() const {  
-    int count = this->fPts.size();
-    
-    if (count == 0) {
+uint32_t GPath::NextUniqueID() {
+    static std::atomic<uint32_t> gNextID{1};
+    return gNextID++;
+}
+
+GRect GPath::ComputeBounds(const std::vector<GPoint>& pts) {
+    if (pts.empty()) {
         return GRect{0.0, 0.0, 0.0, 0.0};
     }
 
-    if (count == 1) {
-        return GRect{fPts[0].x, fPts[0].y, 0.0, 0.0};
-    }
-
-    float min_x = fPts[0].x;
-    float max_x = fPts[0].x;
-    float min_y = fPts[0].y;
-    float max_y = fPts[0].y;
-
-    GPoint points[GPath::kMaxNextPoints];
-    GPath::Edger iterator(*this);
-
-    while (auto verb = iterator.next(points)) {
-        float ax, bx, cx, ay, by, cy;
-        float t1, t2;
-        GPoint A, B, C, D;
-
-        float point_x1 = fPts[0].x;
-        float point_y1 = fPts[0].x;
-        float point_x2 = fPts[0].y;
-        float point_y2 = fPts[0].y;
-
-        switch (verb.value()) {
-            case GPathVerb::kLine:
-                min_x = std::min({min_x, points[0].x, points[1].x});
-                max_x = std::max({max_x, points[0].x, points[1].x});
-                min_y = std::min({min_y, points[0].y, points[1].y});
-                max_y = std::max({max_y, points[0].y, points[1].y});
-
-                break;
-
-            case GPathVerb::kMove:
-                min_x = std::min(min_x, points[0].x);
-                max_x = std::max(max_x, points[0].x);
-                min_y = std::min(min_y, points[0].y);
-                max_y = std::max(max_y, points[0].y);
-
-                break;
-
-            case GPathVerb::kQuad:
-                A = points[0];
-                B = points[1];
-                C = points[2];
-
-                t1 = (A.x - B.x) / (A.x - 2 * B.x + C.x);
-                t2 = (A.y - B.y) / (A.y - 2 * B.y + C.y);
-
-                if(t1 >= 0 && t1 <= 1) {
-                    point_x1 = getQuadPoint(A.x, B.x, C.x, t1).ABC;
-                    point_y1 = getQuadPoint(A.y, B.y, C.y, t1).ABC;
-                }
-
-                if (t2 >= 0 && t2 <= 1) {
-                    point_x2 = getQuadPoint(A.x, B.x, C.x, t2).ABC;
-                    point_y2 = getQuadPoint(A.y, B.y, C.y, t2).ABC;
-                }
-
-                min_x = std::min({min_x, point_x1, point_x2, A.x, C.x});
-                max_x = std::max({max_x, point_x1, point_x2, A.x, C.x});
-                min_y = std::min({min_y, point_y1, point_y2, A.y, C.y});
-                max_y = std::max({max_y, point_y1, point_y2, A.y, C.y});
-
-                break;
-                
-            case GPathVerb::kCubic:
-                A = points[0];
-                B = points[1];
-                C = points[2];
-                D - points[3];
-
-                ax = -A.x + 3 * B.x - 3 * C.x + D.x;
-                bx = 2 * A.x - 4 * B.x + 2 * C.x;
-                cx = -A.x + B.x;
-
-                ay = -A.y + 3 * B.y - 3 * C.y + D.y;
-                by = 2 * A.y - 4 * B.y + 2 * C.y;
-                cy = -A.y + B.y;
-
-                if (ax == 0) {
-                    t1 = -cx / bx;
-                    t2 = -1;
-                } else {
-                    t1 = (-bx + sqrt(bx * bx - (4 * ax * cx))) / (2 * ax);
-                    t2 = (-bx - sqrt(bx * bx - (4 * ax * cx))) / (2 * ax);
-                }
-
-                if (t1 >= 0 && t1 <= 1) {
-                    point_x1 = getCubicPoint(A.x, B.x, C.x, D.x, t1).ABCD;
-                    point_y1 = getCubicPoint(A.y, B.y, C.y, D.y, t1).ABCD;
-                }
-
-                if (t2 >= 0 && t2 <= 1) {
-                    point_x2 = getCubicPoint(A.x, B.x, C.x, D.x, t2).ABCD;
-                    point_y2 = getCubicPoint(A.y, B.y, C.y, D.y, t2).ABCD;
-                }
-
-                min_x = std::min({point_x1, point_x2, A.x, D.x, min_x});
-                max_x = std::max({point_x1, point_x2, A.x, D.x, max_x});
-                min_y = std::min({point_y1, point_y2, A.y, D.y, min_y});
-                max_y = std::min({point_y1, point_y2, A.y, D.y, max_y});
-
-                if (ay == 0) {
-                    t1 = -cy / by;
-                    t2 = -1;
-                } else {
-                    t1 = (-by + sqrt(by * by - (4 * ay * cy))) / (2 * ay);
-                    t2 = (-by - sqrt(by * by - (4 * ay * cy))) / (2 * ay);
-                }
-
-                if (t1 >= 0 && t1 <= 1) {
-                    point_x1 = getCubicPoint(A.x, B.x, C.x, D.x, t1).ABCD;
-                    point_y1 = getCubicPoint(A.y, B.y, C.y, D.y, t1).ABCD;
-                }
-
-                if (t2 >= 0 && t2 <= 1) {
-                    point_x2 = getCubicPoint(A.x, B.x, C.x, D.x, t2).ABCD;
-                    point_y2 = getCubicPoint(A.y, B.y, C.y, D.y, t2).ABCD;
-                }
-
-                min_x = std::min({point_x1, point_x2, A.x, D.x, min_x});
-                max_x = std::max({point_x1, point_x2, A.x, D.x, max_x});
-                min_y = std::min({point_y1, point_y2, A.y, D.y, min_y});
-                max_y = std::min({point_y1, point_y2, A.y, D.y, max_y});
-
-                break;
+    float min_x = pts[0].x;
+    float max_x = pts[0].x;
+    float min_y = pts[0].y;
+    float max_y = pts[0].y;
+
+    // every curve lies inside the hull of its control points, so these bound the curves too
+    for (const GPoint& p : pts) {
+        min_x = std::min(min_x, p.x);
+        max_x = std::max(max_x, p.x);
+        min_y = std::min(min_y, p.y);
+        max_y = std::max(max_y, p.y);
+    }
+
+    return GRect::LTRB(min_x, min_y, max_x, max_y);
+}
+
+static float cross(GVector a, GVector b) {
+    return a.x * b.y - a.y * b.x;
+}
+
+static float dot(GVector a, GVector b) {
+    return a.x * b.x + a.y * b.y;
+}
+
+static int sign_of(float x) {
+    return (x > 0) - (x < 0);
+}
+
+/**
+ *  True if the points, as a closed polygon, turn the same way at every corner and go around
+ *  only once. Repeated points and straight corners are fine; doubling back is not.
+ */
+static bool is_convex_polygon(const std::vector<GPoint>& pts) {
+    const size_t n = pts.size();
+    GVector first = {0, 0}, prev = {0, 0};
+    float turn = 0;
+    int xSign = 0, ySign = 0, xFlips = 0, yFlips = 0;
+
+    // i == n comes back around to the first side, to check the corner it makes with the last
+    for (size_t i = 0; i <= n; ++i) {
+        GVector side = i < n ? pts[(i + 1) % n] - pts[i] : first;
+        if (side.x == 0 && side.y == 0) {
+            continue;
+        }
+        if (first.x == 0 && first.y == 0) {
+            first = prev = side;
+            xSign = sign_of(side.x);
+            ySign = sign_of(side.y);
+            continue;
+        }
+
+        // nearly straight corners are left to the direction checks below
+        const float c = cross(prev, side);
+        const float tolerance = 1e-5f * (fabsf(prev.x) + fabsf(prev.y)) * (fabsf(side.x) + fabsf(side.y));
+        if (fabsf(c) <= tolerance) {
+            if (dot(prev, side) < 0) {
+                return false;
+            }
+        } else if (turn * c < 0) {
+            return false;
+        } else {
+            turn = c;
+        }
+
+        // once around, each of x and y changes direction twice
+        if (side.x != 0) {
+            xFlips += xSign != 0 && sign_of(side.x) != xSign;
+            xSign = sign_of(side.x);
+        }
+        if (side.y != 0) {
+            yFlips += ySign != 0 && sign_of(side.y) != ySign;
+            ySign = sign_of(side.y);
+        }
+        prev = side;
+    }
+
+    return xFlips <= 2 && yFlips <= 2;
+}
+
+// True if the points are the corners of an axis-aligned rectangle (maybe closed with a copy
+// of the first).
+static bool is_rect(const std::vector<GPoint>& pts) {
+    size_t n = pts.size();
+    if (n == 5 && pts[4] == pts[0]) {
+        n = 4;
+    }
+    if (n != 4) {
+        return false;
+    }
+
+    // the sides take turns being horizontal and vertical
+    const bool firstIsHorizontal = pts[0].y == pts[1].y;
+    for (size_t i = 0; i < 4; ++i) {
+        const GPoint a = pts[i], b = pts[(i + 1) % 4];
+        const bool horizontal = (i % 2 == 0) == firstIsHorizontal;
+        if (horizontal ? a.y != b.y : a.x != b.x) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// True if the points are four closed cubics between the ends of two axes that bisect each
+// other, like GPathBuilder::addCircle makes.
+static bool is_oval(const std::vector<GPoint>& pts) {
+    if (pts.size() != 13 || pts[12] != pts[0]) {
+        return false;
+    }
+
+    GPoint a = pts[0], b = pts[3], c = pts[6], d = pts[9];
+    if (a.x == c.x) {
+        // start on the vertical axis instead; swap x and y so the test below reads the same
+        a = {a.y, a.x};
+        b = {b.y, b.x};
+        c = {c.y, c.x};
+        d = {d.y, d.x};
+    }
+
+    const float tolerance = 1e-4f * (fabsf(a.x - c.x) + fabsf(b.y - d.y));
+    return a.y == c.y && b.x == d.x &&
+           fabsf((a.x + c.x) * 0.5f - b.x) <= tolerance &&
+           fabsf((b.y + d.y) * 0.5f - a.y) <= tolerance;
+}
+
+GPath::Shape GPath::shape() const {
+    int shape = fShape.load(std::memory_order_relaxed);
+    if (shape < 0) {
+        shape = (int)this->computeShape();
+        fShape.store(shape, std::memory_order_relaxed);
+    }
+    return (Shape)shape;
+}
+
+GPath::Shape GPath::computeShape() const {
+    // a single contour: one move, then only lines and curves
+    if (fPts.size() < 3 || fVbs.empty() || fVbs[0] != kMove) {
+        return Shape::kGeneral;
+    }
+
+    int lines = 0, cubics = 0;
+    for (size_t i = 1; i < fVbs.size(); ++i) {
+        if (fVbs[i] == kMove) {
+            return Shape::kGeneral;
         }
+        lines += fVbs[i] == kLine;
+        cubics += fVbs[i] == kCubic;
     }
 
-    return GRect{min_x, min_y, max_x, max_y};
+    if (!is_convex_polygon(fPts)) {
+        return Shape::kGeneral;
+    }
+    if (lines == (int)fVbs.size() - 1 && is_rect(fPts)) {
+        return Shape::kRect;
+    }
+    if (cubics == 4 && fVbs.size() == 5 && is_oval(fPts)) {
+        return Shape::kOval;
+    }
+    return Shape::kConvex;
 }
 
 inline void GPathBuilder::transform(const GMatrix& matrix) {
@@ -7,7 +7,9 @@
 #include "stdlib.h"
 #include "include/GMatrix.h"
 #include "include/GPoint.h"
+#include <algorithm>
 #include <cmath>
+#include <string.h>
 #include <iostream>
 #include <vector>
 
@@ -15,6 +17,69 @@ bool MyShader::isOpaque() {
     return fDevice.isOpaque();
 };
 
+// Sample coordinates are 32.32 fixed point.
+static const int kSampleShift = 32;
+static const int64_t kSampleOne = (int64_t)1 << kSampleShift;
+static const int64_t kSampleHalf = kSampleOne >> 1;
+
+// Past these, 32.32 coordinates could overflow at device coordinates of 2^15 (which the
+// edges' 16.16 x can't reach either), so such matrices keep sampling in float.
+static const double kMaxSampleScale = 1 << 12;
+static const double kMaxSampleOffset = 1 << 28;
+
+// Keep the x index table to about a device row or two.
+static const int kMaxXTable = 4096;
+
+static int64_t to_sample(double x) {
+    return (int64_t)llround(x * (double)kSampleOne);
+}
+
+/**
+ *  Steps one sample coordinate along a row and turns it into the pixel it picks on an axis
+ *  size pixels long, the way the float sampler always has: clamp rounds u; repeat rounds u mod
+ *  size; mirror rounds u reflected into [0, size]; repeat and mirror pin to the last pixel
+ *  instead of wrapping. The coordinate is kept wrapped to the tile mode's period, so a step
+ *  is an add (and maybe a subtract).
+ */
+template <GTileMode kMode> class SampleAxis {
+public:
+    SampleAxis(int64_t start, int64_t step, int size)
+        : fSize(size), fLength((int64_t)size << kSampleShift) {
+        fPeriod = kMode == GTileMode::kMirror ? 2 * fLength : fLength;
+        fCoord = kMode == GTileMode::kClamp ? start : this->wrap(start);
+        fStep = kMode == GTileMode::kClamp ? step : this->wrap(step);
+    }
+
+    int index() const {
+        int64_t u = fCoord;
+        if (kMode == GTileMode::kMirror && u > fLength) {
+            u = fPeriod - u;
+        }
+        const int64_t i = (u + kSampleHalf) >> kSampleShift;
+        if (kMode == GTileMode::kClamp) {
+            return (int)std::max<int64_t>(0, std::min<int64_t>(i, fSize - 1));
+        }
+        return (int)std::min<int64_t>(i, fSize - 1);
+    }
+
+    void next() {
+        fCoord += fStep;
+        if (kMode != GTileMode::kClamp && fCoord >= fPeriod) {
+            fCoord -= fPeriod;
+        }
+    }
+
+private:
+    int     fSize;
+    int64_t fLength, fPeriod;
+    int64_t fCoord, fStep;
+
+    int64_t wrap(int64_t u) const {
+        u %= fPeriod;
+        return u < 0 ? u + fPeriod : u;
+    }
+};
+
 bool MyShader::setContext(const GMatrix& ctm) {
     fCTM = ctm;
 
@@ -25,10 +90,156 @@ bool MyShader::setContext(const GMatrix& ctm) {
     } else {
         return false;
     }
+
+    // u = m[0] x + m[2] y + m[4] and v = m[1] x + m[3] y + m[5]
+    const GMatrix& m = fInverse;
+    bool fits = true;
+    for (int i = 0; i < 4; ++i) {
+        fits = fits && fabsf(m[i]) <= kMaxSampleScale;
+    }
+    const double u0 = 0.5 * m[0] + 0.5 * m[2] + m[4];
+    const double v0 = 0.5 * m[1] + 0.5 * m[3] + m[5];
+    if (!fits || !(fabs(u0) <= kMaxSampleOffset) || !(fabs(v0) <= kMaxSampleOffset)) {
+        fShadeProc = &MyShader::shadeFloat;
+        return true;
+    }
+    fU0 = to_sample(u0);
+    fV0 = to_sample(v0);
+    fUX = to_sample(m[0]);
+    fUY = to_sample(m[2]);
+    fVX = to_sample(m[1]);
+    fVY = to_sample(m[3]);
+
+    const bool scaleOnly = m[1] == 0 && m[2] == 0;
+    if (scaleOnly && m[0] == 1 && m[3] == 1 && m[4] == floorf(m[4]) && m[5] == floorf(m[5])) {
+        switch (fTileMode) {
+            case GTileMode::kClamp:  fShadeProc = &MyShader::shadeCopy;                          break;
+            case GTileMode::kRepeat: fShadeProc = &MyShader::shadeTiledCopy<GTileMode::kRepeat>; break;
+            case GTileMode::kMirror: fShadeProc = &MyShader::shadeTiledCopy<GTileMode::kMirror>; break;
+        }
+        return true;
+    }
+
+    if (fTileMode == GTileMode::kClamp && scaleOnly && fUX != 0) {
+        // outside the x where u is within the bitmap (plus a pixel), the index is pinned
+        const double x0 = (double)(-kSampleHalf - fU0) / (double)fUX;
+        const double x1 = (double)(((int64_t)fDevice.width() << kSampleShift) - kSampleHalf - fU0) / (double)fUX;
+        const double left = std::max(0.0, floor(std::min(x0, x1)) - 1);
+        const double right = std::max(left, ceil(std::max(x0, x1)) + 1);
+        if (right - left <= kMaxXTable && right < (1 << 30)) {
+            fXTableLeft = (int)left;
+            // sized for the largest table up front, so later contexts never reallocate it
+            fXTable.reserve(kMaxXTable);
+            fXTable.resize((int)(right - left));
+            SampleAxis<GTileMode::kClamp> u(fU0 + (fXTableLeft - 1) * fUX, fUX, fDevice.width());
+            fXIndexBefore = u.index();
+            for (int& index : fXTable) {
+                u.next();
+                index = u.index();
+            }
+            u.next();
+            fXIndexAfter = u.index();
+            fShadeProc = &MyShader::shadeXTable;
+            return true;
+        }
+    }
+
+    switch (fTileMode) {
+        case GTileMode::kClamp:  fShadeProc = &MyShader::shadeAffine<GTileMode::kClamp>;  break;
+        case GTileMode::kRepeat: fShadeProc = &MyShader::shadeAffine<GTileMode::kRepeat>; break;
+        case GTileMode::kMirror: fShadeProc = &MyShader::shadeAffine<GTileMode::kMirror>; break;
+    }
     return true;
 };
 
 void MyShader::shadeRow(int x, int y, int count, GPixel row[]) {
+    (this->*fShadeProc)(x, y, count, row);
+}
+
+// Integer translate: each row is a run of the bitmap's row, pinned at its ends.
+void MyShader::shadeCopy(int x, int y, int count, GPixel row[]) {
+    const int width = fDevice.width();
+    const int srcY = SampleAxis<GTileMode::kClamp>(fV0 + y * fVY, 0, fDevice.height()).index();
+    const int srcX = (int)((fU0 + (int64_t)x * fUX + kSampleHalf) >> kSampleShift);
+    const GPixel* src = fDevice.getAddr(0, srcY);
+
+    const int before = std::min(count, std::max(0, -srcX));
+    const int copied = std::max(0, std::min(count, width - srcX) - before);
+    std::fill(row, row + before, src[0]);
+    if (copied > 0) {
+        memcpy(row + before, src + srcX + before, copied * sizeof(GPixel));
+    }
+    std::fill(row + before + copied, row + count, src[width - 1]);
+}
+
+/**
+ *  Integer translate, repeated or mirrored: each row is runs of the bitmap's row, copied
+ *  forwards (or backwards, for a mirrored tile). u is x + 0.5 past a whole pixel j of the
+ *  period, so the pixel picked is j + 1, pinned to the last pixel (see SampleAxis), and on
+ *  the mirrored half 2 * width - j.
+ */
+template <GTileMode kMode> void MyShader::shadeTiledCopy(int x, int y, int count, GPixel row[]) {
+    const int width = fDevice.width();
+    const int period = kMode == GTileMode::kMirror ? 2 * width : width;
+    const int srcY = SampleAxis<kMode>(fV0 + y * fVY, 0, fDevice.height()).index();
+    const GPixel* src = fDevice.getAddr(0, srcY);
+
+    int j = (int)(((fU0 + (int64_t)x * fUX) >> kSampleShift) % period);
+    if (j < 0) {
+        j += period;
+    }
+
+    int i = 0;
+    while (i < count) {
+        if (j < width - 1) {
+            const int n = std::min(count - i, width - 1 - j);
+            memcpy(row + i, src + j + 1, n * sizeof(GPixel));
+            i += n;
+            j += n;
+        } else if (j <= width) {
+            // the pinned pixel: once for repeat, twice (at the turn) for mirror
+            row[i++] = src[width - 1];
+            j++;
+        } else {
+            const int n = std::min(count - i, period - j);
+            for (int k = 0; k < n; ++k) {
+                row[i + k] = src[period - j - k];
+            }
+            i += n;
+            j += n;
+        }
+        if (j == period) {
+            j = 0;
+        }
+    }
+}
+
+// Scale + translate: one src row per dst row, and the x indices were computed up front.
+void MyShader::shadeXTable(int x, int y, int count, GPixel row[]) {
+    const int srcY = SampleAxis<GTileMode::kClamp>(fV0 + y * fVY, 0, fDevice.height()).index();
+    const GPixel* src = fDevice.getAddr(0, srcY);
+    const int size = (int)fXTable.size();
+
+    for (int i = 0; i < count; i++) {
+        const int t = x + i - fXTableLeft;
+        row[i] = src[t < 0 ? fXIndexBefore : t < size ? fXTable[t] : fXIndexAfter];
+    }
+}
+
+// Any other matrix: (u, v) step by the inverse's x column from pixel to pixel.
+template <GTileMode kMode> void MyShader::shadeAffine(int x, int y, int count, GPixel row[]) {
+    SampleAxis<kMode> u(fU0 + (int64_t)x * fUX + (int64_t)y * fUY, fUX, fDevice.width());
+    SampleAxis<kMode> v(fV0 + (int64_t)x * fVX + (int64_t)y * fVY, fVX, fDevice.height());
+
+    for (int i = 0; i < count; i++) {
+        row[i] = *fDevice.getAddr(u.index(), v.index());
+        u.next();
+        v.next();
+    }
+}
+
+// Matrices too big for 32.32 coordinates map every pixel in float.
+void MyShader::shadeFloat(int x, int y, int count, GPixel row[]) {
     int width = fDevice.width();
     int height = fDevice.height();
 
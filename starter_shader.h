@@ -13,6 +13,7 @@
 #include "include/GPoint.h"
 #include "include/GBlendMode.h"
 #include "my_utils.h"
+#include <vector>
 
 class MyShader : public GShader {
 public:
@@ -31,6 +32,9 @@ public:
      */
     void shadeRow(int x, int y, int count, GPixel row[]) override;
 
+    // shadeRow() only reads the bitmap and what setContext() computed.
+    bool isThreadSafe() override { return true; }
+
 private:
     // Note: we store a copy of the bitmap
     const GBitmap fDevice;
@@ -38,6 +42,28 @@ private:
     GMatrix fCTM; 
     GMatrix fInverse;
     GTileMode fTileMode;
+
+    /**
+     *  setContext() picks the cheapest way to sample for the inverse matrix: row copies for
+     *  an integer translate, an x index table for scale + translate, or stepping (u, v) by
+     *  the matrix's x column for anything else. All of them pick pixels by the same rule
+     *  (see SampleAxis in the .cpp).
+     */
+    void (MyShader::*fShadeProc)(int x, int y, int count, GPixel row[]) = nullptr;
+
+    // Sample coordinates in 32.32: u = fU0 + x * fUX + y * fUY at the center of pixel (x, y).
+    int64_t fU0, fUX, fUY;
+    int64_t fV0, fVX, fVY;
+
+    // x index for pixels [fXTableLeft ... fXTableLeft + size), and the ones before and after
+    std::vector<int> fXTable;
+    int fXTableLeft, fXIndexBefore, fXIndexAfter;
+
+    void shadeCopy(int x, int y, int count, GPixel row[]);
+    template <GTileMode kMode> void shadeTiledCopy(int x, int y, int count, GPixel row[]);
+    void shadeXTable(int x, int y, int count, GPixel row[]);
+    template <GTileMode kMode> void shadeAffine(int x, int y, int count, GPixel row[]);
+    void shadeFloat(int x, int y, int count, GPixel row[]);
 };
 
 /**
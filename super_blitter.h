@@ -0,0 +1,102 @@
+/*
+ *  Copyright 2024 Tyler Roth
+ */
+
+#ifndef _g_super_blitter_h_
+#define _g_super_blitter_h_
+
+#include "blitter.h"
+#include "GEdge.h"
+#include <string.h>
+
+/**
+ *  Anti-aliasing front end for a Blitter (or anything else with its blitAntiRow(), such as a
+ *  SpanList). The scanners run over edges whose y has been scaled
+ *  by kScale, so they hand this kScale sub-rows per device row; x is still in device pixels
+ *  and is rounded here to the nearest 1/kScale. Each pixel counts how many of its
+ *  kScale x kScale subsamples were covered, and when the scan moves past a device row that
+ *  row is sent to the blitter with partial coverage.
+ *
+ *  Only one device row of counts is kept, so the memory cost is a byte per pixel of width.
+ */
+template <typename AntiBlitter = Blitter> class SuperBlitter {
+public:
+    static constexpr int kShift = 2;
+    static constexpr int kScale = 1 << kShift;
+
+    /**
+     *  coverage must have room for width bytes, all zero. It is left zeroed again once the
+     *  last row has been blitted.
+     */
+    SuperBlitter(AntiBlitter& blitter, int width, int height, uint8_t coverage[])
+        : fBlitter(blitter), fCoverage(coverage), fWidth(width), fHeight(height) {}
+
+    ~SuperBlitter() {
+        this->flushRow();
+    }
+
+    // The sub-rows a scanner may pass to blitFixedRow().
+    int height() const { return fHeight << kShift; }
+
+    // Cover the subsamples of sub-row superY whose centers are in (xLeft ... xRight].
+    void blitFixedRow(int superY, GFixed xLeft, GFixed xRight) {
+        const int y = superY >> kShift;
+        if (y != fY) {
+            this->flushRow();
+            fY = y;
+        }
+
+        const int superWidth = fWidth << kShift;
+        const int left = std::max(0, to_subsample(xLeft));
+        const int right = std::min(superWidth, to_subsample(xRight));
+        if (left >= right) {
+            return;
+        }
+
+        const int firstX = left >> kShift;
+        const int lastX = (right - 1) >> kShift;
+        fLeft = std::min(fLeft, firstX);
+        fRight = std::max(fRight, lastX + 1);
+
+        if (firstX == lastX) {
+            fCoverage[firstX] += right - left;
+            return;
+        }
+
+        fCoverage[firstX] += kScale - (left & (kScale - 1));
+        for (int x = firstX + 1; x < lastX; ++x) {
+            fCoverage[x] += kScale;
+        }
+        fCoverage[lastX] += right - (lastX << kShift);
+    }
+
+private:
+    AntiBlitter&    fBlitter;
+    uint8_t*        fCoverage;
+    int             fWidth, fHeight;
+    int             fY = -1;
+
+    // pixels of row fY that have any coverage
+    int             fLeft = std::numeric_limits<int>::max();
+    int             fRight = 0;
+
+    static int to_subsample(GFixed x) {
+        const int shift = kFixedShift - kShift;
+        return (x + (1 << (shift - 1))) >> shift;
+    }
+
+    void flushRow() {
+        if (fLeft < fRight) {
+            // kScale * kScale subsamples -> 0...255
+            for (int x = fLeft; x < fRight; ++x) {
+                fCoverage[x] = (fCoverage[x] * 255 + (kScale * kScale >> 1)) >> (2 * kShift);
+            }
+            fBlitter.blitAntiRow(fY, fLeft, fRight - fLeft, fCoverage + fLeft);
+            memset(fCoverage + fLeft, 0, fRight - fLeft);
+        }
+        fLeft = std::numeric_limits<int>::max();
+        fRight = 0;
+    }
+};
+
+#endif
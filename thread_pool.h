@@ -0,0 +1,122 @@
+/*
+ *  Copyright 2024 Tyler Roth
+ */
+
+#ifndef _g_thread_pool_h_
+#define _g_thread_pool_h_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ *  A fixed set of threads for splitting one draw call across cores. The thread that calls
+ *  parallelFor() does its share of the work too, so a pool of threadCount() == 1 starts no
+ *  threads at all and simply runs everything in order.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(int threadCount) {
+        for (int i = 1; i < threadCount; ++i) {
+            fWorkers.emplace_back([this, i] { this->work(i); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            fQuit = true;
+        }
+        fWake.notify_all();
+        for (std::thread& worker : fWorkers) {
+            worker.join();
+        }
+    }
+
+    int threadCount() const { return (int)fWorkers.size() + 1; }
+
+    /**
+     *  Call task(index, thread) for every index in [0, count) and return once all of them
+     *  have finished. thread is in [0, threadCount()) and identifies who is running the task,
+     *  so tasks can use per-thread buffers. The workers call task through a pointer to it,
+     *  so handing over a lambda never allocates, whatever it captures.
+     */
+    template <typename Task> void parallelFor(int count, Task&& task) {
+        if (fWorkers.empty() || count <= 1) {
+            for (int i = 0; i < count; ++i) {
+                task(i, 0);
+            }
+            return;
+        }
+
+        using TaskType = typename std::remove_reference<Task>::type;
+        this->run(count, (void*)&task, [](void* context, int index, int thread) {
+            (*(TaskType*)context)(index, thread);
+        });
+    }
+
+private:
+    std::vector<std::thread>    fWorkers;
+    std::mutex                  fMutex;
+    std::condition_variable     fWake, fDone;
+
+    // the current parallelFor(), guarded by fMutex (except fNext)
+    void*               fTask = nullptr;
+    void              (*fTaskProc)(void* task, int index, int thread) = nullptr;
+    int                 fCount = 0;
+    std::atomic<int>    fNext{0};
+    int                 fBusy = 0;
+    uint64_t            fGeneration = 0;
+    bool                fQuit = false;
+
+    void run(int count, void* task, void (*taskProc)(void*, int, int)) {
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            fTask = task;
+            fTaskProc = taskProc;
+            fCount = count;
+            fNext = 0;
+            fBusy = (int)fWorkers.size();
+            fGeneration += 1;
+        }
+        fWake.notify_all();
+
+        this->runTasks(0);
+
+        std::unique_lock<std::mutex> lock(fMutex);
+        fDone.wait(lock, [this] { return fBusy == 0; });
+        fTask = nullptr;
+    }
+
+    void work(int thread) {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(fMutex);
+                fWake.wait(lock, [&] { return fQuit || fGeneration != seen; });
+                if (fQuit) {
+                    return;
+                }
+                seen = fGeneration;
+            }
+
+            this->runTasks(thread);
+
+            std::lock_guard<std::mutex> lock(fMutex);
+            if (--fBusy == 0) {
+                fDone.notify_one();
+            }
+        }
+    }
+
+    void runTasks(int thread) {
+        for (int i = fNext.fetch_add(1); i < fCount; i = fNext.fetch_add(1)) {
+            fTaskProc(fTask, i, thread);
+        }
+    }
+};
+
+#endif
@@ -41,6 +41,8 @@ class TriangleShader : public GShader {
             return true;
         }
 
+        bool isThreadSafe() override { return true; }
+
         void shadeRow(int x, int y, int count, GPixel row[]) override {
             GPoint dst = { x + 0.5f, y + 0.5f };
             GPoint src = fInverse * dst;